@@ -0,0 +1,32 @@
+#ifndef ASCII_PARAMS_H
+#define ASCII_PARAMS_H
+
+// Settings of the ASCII effect, named after the uniforms in HLSL/Shaders/ASCII.fx.
+// Defaults are the values main.cpp has always pushed to the GL shaders.
+struct AsciiParams {
+    float zoom = 1.0f;
+    float offset[2] = {0.0f, 0.0f};
+    int kernelSize = 2;
+    float sigma = 2.0f;
+    float sigmaScale = 1.6f;
+    float tau = 1.0f;
+    float threshold = 0.005f;
+    bool useDepth = true;
+    float depthThreshold = 0.1f;
+    bool useNormals = true;
+    float normalThreshold = 0.1f;
+    float depthCutoff = 0.0f;
+    int edgeThreshold = 8;
+    bool edges = true;
+    bool fill = true;
+    float exposure = 1.0f;
+    float attenuation = 1.0f;
+    bool invertLuminance = false;
+    float asciiColor[3] = {1.0f, 1.0f, 1.0f};
+    float backgroundColor[3] = {0.0f, 0.0f, 0.0f};
+    float blendWithBase = 0.0f;
+    float depthFalloff = 0.0f;
+    float depthOffset = 0.0f;
+};
+
+#endif
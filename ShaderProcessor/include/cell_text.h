@@ -0,0 +1,21 @@
+#ifndef CELL_TEXT_H
+#define CELL_TEXT_H
+
+#include "ascii_params.h"
+
+// What the program writes: the rasterised image, in the file format of
+// ImageFormat, or the character grid itself with one character per 8x8 cell
+// and no glyph compositing at all.
+enum class OutputFormat {
+    Image,
+    Text,  // UTF-8 text, one line per cell row
+    ANSI,  // text coloured with 24-bit escapes from each cell's average colour
+};
+
+// Writes the cellsX x cellsY grid CS_RenderASCII would draw. cellEdges holds
+// the winning edge direction per cell (-1 for none) and downscale the RGBA
+// cell averages of PS_Downscale, luminance in w.
+bool writeCellText(const char* path, OutputFormat format, int cellsX, int cellsY, const int* cellEdges,
+                   const float* downscale, const AsciiParams& params);
+
+#endif
@@ -0,0 +1,142 @@
+#ifndef CPU_KERNELS_H
+#define CPU_KERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Hot loops of the CPU pipeline with scalar, SSE4.1, AVX2 and AVX-512
+// variants. cpuKernels() picks the widest variant the CPU supports the first
+// time it is called; every variant produces bit-identical results.
+
+enum class SimdLevel {
+    Scalar,
+    SSE41,
+    AVX2,
+    AVX512,
+};
+
+// One cell row (up to 8 pixel rows) of PS_Luminance + PS_Downscale in a
+// single read of the source pixels.
+struct LumaDownscaleArgs {
+    const unsigned char* pixels;  // first row of the cell row, 3 or 4 channels for SIMD
+    size_t pixelStride;           // bytes between rows
+    int channels;
+    int width;
+    int rows;                     // 1-8
+    float* luminance;             // first luminance row of the cell row
+    unsigned char* luminance8;    // the same for the fixed-point kernel, round(255 * Y)
+    size_t luminanceStride;       // floats between rows
+    float* downscale;             // RGBA per cell: average colour, luminance in w
+};
+
+typedef void (*LumaDownscaleFn)(const LumaDownscaleArgs& args, int cellBegin, int cellEnd);
+
+// PS_HorizontalBlur for one row: ping receives the (narrow, wide) blur of
+// every pixel, the row clamped at both ends. taps are laid out as in DogWeights.
+typedef void (*BlurRowFn)(const float* luminance, int width, const float* taps, int radius, float* ping);
+
+// PS_VerticalBlurAndDifference for one row. pingRows[i] is the ping row at
+// vertical offset i - radius, already clamped to the image.
+typedef void (*BlurDifferenceRowFn)(const float* const* pingRows, int width, const float* taps, int radius,
+                                    float tau, float threshold, float* dog);
+
+// CS_RenderASCII's glyph lookup and colouring for one cell: pixel (x, y)
+// gets foreground where bit y * 8 + x of glyph is set, background elsewhere.
+// Both colours are RGB bytes; out is the cell's top-left pixel of an RGB
+// image with outStride bytes per row.
+typedef void (*ExpandGlyphFn)(uint64_t glyph, const unsigned char* foreground, const unsigned char* background,
+                              int columns, int rows, unsigned char* out, size_t outStride);
+
+// Fixed-point counterparts for the integer pipeline. Luminance is one byte,
+// the DoG taps are 0.16 fixed point (quantizeDogWeights) applied with a
+// high-half multiply, and ping holds the (narrow, wide) blurs of luminance
+// * 255 * 256 in u16. The difference test works in 32 bits on ping >> 1:
+// 256 * narrow - tauQ8 * wide >= thresholdQ, with tauQ8 = tau * 256 and
+// thresholdQ = threshold * 255 * 128 * 256. dog receives 0 or 1 per pixel.
+typedef void (*BlurRowU16Fn)(const unsigned char* luminance, int width, const uint16_t* taps, int radius,
+                             uint16_t* ping);
+typedef void (*BlurDifferenceRowU16Fn)(const uint16_t* const* pingRows, int width, const uint16_t* taps, int radius,
+                                       int tauQ8, int thresholdQ, unsigned char* dog);
+
+struct CpuKernels {
+    SimdLevel level;
+    const char* name;
+    LumaDownscaleFn lumaDownscale;  // writes cells [cellBegin, cellEnd) of the row
+    BlurRowFn blurRow;
+    BlurDifferenceRowFn blurDifferenceRow;
+    ExpandGlyphFn expandGlyph;
+    LumaDownscaleFn lumaDownscaleU8;  // writes luminance8 instead of luminance
+    BlurRowU16Fn blurRowU16;
+    BlurDifferenceRowU16Fn blurDifferenceRowU16;
+};
+
+const CpuKernels& cpuKernels();
+
+// Caps the dispatch at a lower level, e.g. to compare variants. Returns false
+// for an unknown name; the CPU's best level is used if the request exceeds it.
+bool setCpuKernelLevel(const char* name);
+
+// Scalar reference kernels; the SIMD variants fall back to these for
+// partial cells and greyscale input.
+void lumaDownscaleScalar(const LumaDownscaleArgs& args, int cellBegin, int cellEnd);
+void blurRowScalar(const float* luminance, int width, const float* taps, int radius, float* ping);
+void blurDifferenceRowScalar(const float* const* pingRows, int width, const float* taps, int radius,
+                             float tau, float threshold, float* dog);
+void expandGlyphScalar(uint64_t glyph, const unsigned char* foreground, const unsigned char* background,
+                       int columns, int rows, unsigned char* out, size_t outStride);
+void lumaDownscaleU8Scalar(const LumaDownscaleArgs& args, int cellBegin, int cellEnd);
+void blurRowU16Scalar(const unsigned char* luminance, int width, const uint16_t* taps, int radius, uint16_t* ping);
+void blurDifferenceRowU16Scalar(const uint16_t* const* pingRows, int width, const uint16_t* taps, int radius,
+                                int tauQ8, int thresholdQ, unsigned char* dog);
+
+// The same loops restricted to pixels [x0, x1), for the SIMD borders and tails.
+void blurSpanScalar(const float* luminance, int width, const float* taps, int radius, float* ping, int x0, int x1);
+void blurDifferenceSpanScalar(const float* const* pingRows, const float* taps, int radius,
+                              float tau, float threshold, float* dog, int x0, int x1);
+void blurSpanU16Scalar(const unsigned char* luminance, int width, const uint16_t* taps, int radius, uint16_t* ping,
+                       int x0, int x1);
+void blurDifferenceSpanU16Scalar(const uint16_t* const* pingRows, const uint16_t* taps, int radius, int tauQ8,
+                                 int thresholdQ, unsigned char* dog, int x0, int x1);
+
+// Averages the RGB byte sums of a cell of count pixels into args.downscale.
+void storeCellAverage(float* cell, unsigned int sumR, unsigned int sumG, unsigned int sumB, int count);
+
+// Weights of the luminance dot product applied directly to 0-255 values.
+const float LUMA_R = 0.2127f / 255.0f;
+const float LUMA_G = 0.7152f / 255.0f;
+const float LUMA_B = 0.0722f / 255.0f;
+const float LUMA_MIN = 0.00001f;
+
+// The same weights in 8.8 fixed point, summing to 256 so white stays 255.
+const int LUMA_R8 = 54;
+const int LUMA_G8 = 183;
+const int LUMA_B8 = 19;
+
+#ifdef ASCII_X86_KERNELS
+void lumaDownscaleSSE41(const LumaDownscaleArgs& args, int cellBegin, int cellEnd);
+void lumaDownscaleAVX2(const LumaDownscaleArgs& args, int cellBegin, int cellEnd);
+void lumaDownscaleAVX512(const LumaDownscaleArgs& args, int cellBegin, int cellEnd);
+void blurRowSSE41(const float* luminance, int width, const float* taps, int radius, float* ping);
+void blurRowAVX2(const float* luminance, int width, const float* taps, int radius, float* ping);
+void blurRowAVX512(const float* luminance, int width, const float* taps, int radius, float* ping);
+void blurDifferenceRowSSE41(const float* const* pingRows, int width, const float* taps, int radius,
+                            float tau, float threshold, float* dog);
+void blurDifferenceRowAVX2(const float* const* pingRows, int width, const float* taps, int radius,
+                           float tau, float threshold, float* dog);
+void blurDifferenceRowAVX512(const float* const* pingRows, int width, const float* taps, int radius,
+                             float tau, float threshold, float* dog);
+// A cell row is 24 bytes, so the wider levels reuse the SSE4.1 expansion.
+void expandGlyphSSE41(uint64_t glyph, const unsigned char* foreground, const unsigned char* background,
+                      int columns, int rows, unsigned char* out, size_t outStride);
+// Cells are 8 pixels wide, so the u8 luminance kernel is SSE4.1 at every level;
+// the u16 blurs have AVX2 variants, which AVX-512 reuses.
+void lumaDownscaleU8SSE41(const LumaDownscaleArgs& args, int cellBegin, int cellEnd);
+void blurRowU16SSE41(const unsigned char* luminance, int width, const uint16_t* taps, int radius, uint16_t* ping);
+void blurRowU16AVX2(const unsigned char* luminance, int width, const uint16_t* taps, int radius, uint16_t* ping);
+void blurDifferenceRowU16SSE41(const uint16_t* const* pingRows, int width, const uint16_t* taps, int radius,
+                               int tauQ8, int thresholdQ, unsigned char* dog);
+void blurDifferenceRowU16AVX2(const uint16_t* const* pingRows, int width, const uint16_t* taps, int radius,
+                              int tauQ8, int thresholdQ, unsigned char* dog);
+#endif
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef CPU_KERNELS_X86_H
+#define CPU_KERNELS_X86_H
+
+// Helpers shared by the x86 kernel translation units. Everything here is
+// static so each unit keeps its own copy, compiled for its own target; an
+// inline function shared across units could be resolved to the AVX-512 copy
+// and fault on older CPUs.
+
+#include <immintrin.h>
+
+// Loads one (narrow, wide) tap pair into the low 64 bits, ready to broadcast
+// across the interleaved ping lanes without a round trip through memory.
+static inline __m128i tapPair(const float* taps) {
+    return _mm_loadl_epi64(reinterpret_cast<const __m128i*>(taps));
+}
+
+// Deinterleaves 8 RGB or RGBA pixels into the low 8 bytes of r, g and b
+// (upper bytes zero). Reads exactly 8 * channels bytes.
+static inline void deinterleave8(const unsigned char* src, int channels, __m128i& r, __m128i& g, __m128i& b) {
+    if (channels == 3) {
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 8));
+        r = _mm_or_si128(_mm_shuffle_epi8(lo, _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+                         _mm_shuffle_epi8(hi, _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1)));
+        g = _mm_or_si128(_mm_shuffle_epi8(lo, _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+                         _mm_shuffle_epi8(hi, _mm_setr_epi8(-1, -1, -1, -1, -1, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1)));
+        b = _mm_or_si128(_mm_shuffle_epi8(lo, _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+                         _mm_shuffle_epi8(hi, _mm_setr_epi8(-1, -1, -1, -1, -1, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1)));
+    } else {
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+        r = _mm_or_si128(_mm_shuffle_epi8(lo, _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+                         _mm_shuffle_epi8(hi, _mm_setr_epi8(-1, -1, -1, -1, 0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1)));
+        g = _mm_or_si128(_mm_shuffle_epi8(lo, _mm_setr_epi8(1, 5, 9, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+                         _mm_shuffle_epi8(hi, _mm_setr_epi8(-1, -1, -1, -1, 1, 5, 9, 13, -1, -1, -1, -1, -1, -1, -1, -1)));
+        b = _mm_or_si128(_mm_shuffle_epi8(lo, _mm_setr_epi8(2, 6, 10, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1)),
+                         _mm_shuffle_epi8(hi, _mm_setr_epi8(-1, -1, -1, -1, 2, 6, 10, 14, -1, -1, -1, -1, -1, -1, -1, -1)));
+    }
+}
+
+#endif
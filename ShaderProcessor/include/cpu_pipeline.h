@@ -0,0 +1,76 @@
+#ifndef CPU_PIPELINE_H
+#define CPU_PIPELINE_H
+
+#include <vector>
+#include "ascii_params.h"
+#include "cell_text.h"
+#include "dog_weights.h"
+#include "glyph_atlas.h"
+#include "image_writer.h"
+#include "thread_pool.h"
+
+// Interleaved 8-bit pixels as returned by stbi_load, row 0 at the top.
+struct CpuImage {
+    const unsigned char* pixels = nullptr;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+};
+
+// Cell rows per task of runCpuAnalysis. Each pass runs as one task per strip
+// of this many cell rows, started as soon as the strips it reads are done.
+const int CPU_STRIP_CELL_ROWS = 1;
+
+// One float plane per render target of the GL pipeline, in the same layout.
+struct CpuIntermediates {
+    int width = 0;
+    int height = 0;
+    int cellsX = 0;
+    int cellsY = 0;
+    std::vector<float> luminance;  // R,    AFX_LuminanceAsciiTex
+    std::vector<float> downscale;  // RGBA, AFX_DownscaleTex (one texel per cell)
+    std::vector<float> ping;       // RG,   AFX_AsciiPingTex
+    std::vector<float> dog;        // R,    AFX_AsciiDogTex
+    std::vector<float> normals;    // RGBA, only filled when a depth plane is given
+    std::vector<float> edges;      // R,    AFX_AsciiEdgesTex
+    std::vector<float> sobel;      // RG,   AFX_AsciiSobelTex (theta, valid)
+    std::vector<int> cellEdges;    // winning edge direction per cell, -1 for none
+    DogWeights dogWeights;         // kept with the buffers so repeated frames reuse the taps
+};
+
+// Maps each output column (or row) to the source texel transformUV() lands on,
+// or -1 where it falls outside the image (the border sampler returns black).
+void buildSourceMap(int size, float offset, float zoom, std::vector<int>& map);
+
+// RGB of source texel (x, y) in 0-1, black for a -1 coordinate from buildSourceMap.
+void readSource(const CpuImage& input, int x, int y, float rgb[3]);
+
+// Every stage up to the per-cell edge vote, leaving downscale and cellEdges
+// ready for glyph lookup or for writeCellText. The passes run as a TaskGraph
+// of strips with halo dependencies rather than one after another.
+void runCpuAnalysis(const CpuImage& input, const float* depth, const AsciiParams& params, ThreadPool& pool,
+                    CpuIntermediates& buffers);
+
+// CS_RenderASCII's glyph lookup and colouring from per-cell results: the
+// RGBA cell averages and the winning edge direction of each cell.
+void composeCells(int width, int height, const float* downscale, const int* cellEdges, const float* depth,
+                  const AsciiParams& params, const GlyphAtlas& edgesAtlas, const GlyphAtlas& fillAtlas,
+                  ThreadPool& pool, std::vector<unsigned char>& output);
+
+// Runs every stage of the ASCII pipeline on the CPU, each stage split into
+// row bands across the pool. depth may be null; images carry no depth buffer,
+// in which case the normals and fog terms drop out exactly as they do for a
+// constant depth. output receives width * height RGB bytes.
+void runCpuPipeline(const CpuImage& input, const float* depth, const AsciiParams& params,
+                    const GlyphAtlas& edgesAtlas, const GlyphAtlas& fillAtlas, ThreadPool& pool,
+                    CpuIntermediates& buffers, std::vector<unsigned char>& output);
+
+// Queues the rendered image on writer, in writer's format, or for the text
+// formats writes only the character grid. buffers is kept by the caller
+// across the frames of a sequence, so the planes are only reallocated when
+// the size changes and the blur taps only when the parameters do.
+bool processFrameCPU(const CpuImage& input, const char* outputPath, OutputFormat format, const AsciiParams& params,
+                     const GlyphAtlas& edgesAtlas, const GlyphAtlas& fillAtlas, ThreadPool& pool,
+                     CpuIntermediates& buffers, ImageWriter& writer);
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef CPU_STAGES_H
+#define CPU_STAGES_H
+
+#include <algorithm>
+#include <cmath>
+#include "ascii_params.h"
+#include "glyph_atlas.h"
+
+// Per-pixel math shared by the CPU implementations of the ASCII passes.
+// Each helper is a direct transcription of the matching code in ASCII.fx.
+
+const float ASCII_PI = 3.14159265358979323846f;
+
+inline float asciiLuminance(float r, float g, float b) {
+    return std::max(0.00001f, r * 0.2127f + g * 0.7152f + b * 0.0722f);
+}
+
+inline float asciiGaussian(float sigma, float pos) {
+    return (1.0f / std::sqrt(2.0f * ASCII_PI * sigma * sigma)) * std::exp(-(pos * pos) / (2.0f * sigma * sigma));
+}
+
+inline float asciiSaturate(float v) {
+    return std::min(std::max(v, 0.0f), 1.0f);
+}
+
+// Edge direction of one Sobel texel as classified by CS_RenderASCII:
+// 0 vertical, 1 horizontal, 2 and 3 the diagonals, -1 for no edge.
+inline int asciiEdgeDirection(float theta, float valid) {
+    if (valid == 0.0f) return -1;
+    float absTheta = std::fabs(theta) / ASCII_PI;
+    if (absTheta < 0.05f) return 0;
+    if (0.9f < absTheta && absTheta <= 1.0f) return 0;
+    if (0.45f < absTheta && absTheta < 0.55f) return 1;
+    if (0.05f < absTheta && absTheta < 0.45f) return theta > 0.0f ? 3 : 2;
+    if (0.55f < absTheta && absTheta < 0.9f) return theta > 0.0f ? 2 : 3;
+    return -1;
+}
+
+// Bit of pixel (x, y) in an 8x8 cell mask, laid out like the glyph masks.
+inline uint64_t asciiCellBit(int x, int y) {
+    return uint64_t(1) << ((y & 7) * 8 + (x & 7));
+}
+
+inline int asciiPopcount(uint64_t bits) {
+#if defined(__GNUC__)
+    return __builtin_popcountll(bits);
+#else
+    bits = bits - ((bits >> 1) & 0x5555555555555555ull);
+    bits = (bits & 0x3333333333333333ull) + ((bits >> 2) & 0x3333333333333333ull);
+    bits = (bits + (bits >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return static_cast<int>((bits * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+// CS_RenderASCII's vote over one cell. planes[d] holds the asciiCellBit of
+// every pixel with edge direction d, so each count is a popcount. The first
+// direction with the most pixels wins, if it has at least edgeThreshold.
+inline int asciiCellVote(const uint64_t planes[4], int edgeThreshold) {
+    int commonEdgeIndex = -1;
+    int maxValue = 0;
+    for (int j = 0; j < 4; ++j) {
+        int count = asciiPopcount(planes[j]);
+        if (count > maxValue) {
+            commonEdgeIndex = j;
+            maxValue = count;
+        }
+    }
+    return maxValue < edgeThreshold ? -1 : commonEdgeIndex;
+}
+
+// Index of the fillASCII glyph (0-9) for a cell's average luminance.
+inline int asciiFillGlyph(float cellLuminance, const AsciiParams& params) {
+    float luminance = asciiSaturate(std::pow(cellLuminance * params.exposure, params.attenuation));
+    if (params.invertLuminance) luminance = 1.0f - luminance;
+    return static_cast<int>(std::max(0.0f, std::floor(luminance * 10.0f) - 1.0f));
+}
+
+// Atlas row for row y of an edge glyph; CS_RenderASCII samples 8 - (y % 8)
+// through a repeating sampler, which flips the glyph and wraps 8 back to 0.
+inline int asciiEdgeGlyphRow(int y) {
+    return (8 - (y & 7)) & 7;
+}
+
+// Edge glyph rearranged so that row y of a cell is row y of the mask.
+inline uint64_t asciiEdgeGlyph(uint64_t atlasGlyph) {
+    uint64_t glyph = 0;
+    for (int y = 0; y < 8; ++y) {
+        glyph |= ((atlasGlyph >> (asciiEdgeGlyphRow(y) * 8)) & 0xFF) << (y * 8);
+    }
+    return glyph;
+}
+
+// The glyph CS_RenderASCII draws over a whole cell, rows in output order: the
+// winning edge direction's glyph, else the fill glyph for the cell's
+// luminance, else nothing.
+inline uint64_t asciiCellGlyph(int commonEdgeIndex, float cellLuminance, const AsciiParams& params,
+                               const GlyphAtlas& edgesAtlas, const GlyphAtlas& fillAtlas) {
+    if (commonEdgeIndex >= 0 && params.edges) return asciiEdgeGlyph(edgesAtlas.glyph(commonEdgeIndex + 1));
+    if (params.fill) return fillAtlas.glyph(asciiFillGlyph(cellLuminance, params));
+    return 0;
+}
+
+// Final colour of one pixel: glyph coverage ascii over the cell's average
+// colour info (RGB), faded towards the background by fogFactor.
+inline void asciiComposePixel(float ascii, const float* info, float fogFactor, const AsciiParams& params,
+                              unsigned char* out) {
+    for (int c = 0; c < 3; ++c) {
+        float base = params.asciiColor[c] + (info[c] - params.asciiColor[c]) * params.blendWithBase;
+        float colour = params.backgroundColor[c] + (base - params.backgroundColor[c]) * ascii;
+        colour = params.backgroundColor[c] + (colour - params.backgroundColor[c]) * fogFactor;
+        out[c] = static_cast<unsigned char>(asciiSaturate(colour) * 255.0f + 0.5f);
+    }
+}
+
+#endif
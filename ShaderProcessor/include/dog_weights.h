@@ -0,0 +1,30 @@
+#ifndef DOG_WEIGHTS_H
+#define DOG_WEIGHTS_H
+
+#include <cstdint>
+#include <vector>
+#include "ascii_params.h"
+
+// Normalised 1D gaussian taps of both DoG blurs, interleaved as (narrow, wide)
+// pairs for offsets -radius..radius: the layout of the _BlurWeights vec2
+// array in the blur shaders. Only recomputed when _Sigma, _SigmaScale or
+// _KernelSize change.
+struct DogWeights {
+    static constexpr int MAX_RADIUS = 10;  // _KernelSize slider maximum in ASCII.fx
+
+    int radius = -1;
+    float sigma = 0.0f;
+    float sigmaScale = 0.0f;
+    std::vector<float> taps;
+
+    int tapCount() const { return 2 * radius + 1; }
+
+    // Returns true when the taps were recomputed.
+    bool update(const AsciiParams& params);
+};
+
+// The same taps in 0.16 fixed point for the integer pipeline, rounded and then
+// corrected at the centre so each gaussian sums to exactly 65535.
+void quantizeDogWeights(const DogWeights& weights, std::vector<uint16_t>& taps);
+
+#endif
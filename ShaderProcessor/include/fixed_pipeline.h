@@ -0,0 +1,64 @@
+#ifndef FIXED_PIPELINE_H
+#define FIXED_PIPELINE_H
+
+#include <cstdint>
+#include <vector>
+#include "cpu_pipeline.h"
+
+// Integer counterparts of CpuIntermediates. The cell averages come from exact
+// integer sums and the Sobel stage is exact for a given DoG, so the DoG
+// threshold test is the only place the fixed-point pipeline can disagree
+// with the float one. Measured with --compare at the default parameters:
+// 0.035% of cells on frame1358.png and 0.048% on odd.png; on uniform random
+// RGB noise 2.16-2.24% at 3840x2160 and 2.15-2.43% at 1920x1080 (three
+// images each), and 1.25-3.75% at 160x96 (twenty images), where each cell is
+// a larger share. A cell that differs draws a different glyph, so --compare
+// reports a max channel error of 255 whenever any cell does.
+struct FixedIntermediates {
+    int width = 0;
+    int height = 0;
+    int cellsX = 0;
+    int cellsY = 0;
+    std::vector<unsigned char> remapped;   // RGB source after transformUV, only when zoomed or offset
+    std::vector<unsigned char> luminance;  // round(255 * Y)
+    std::vector<float> downscale;          // RGBA per cell, as in CpuIntermediates
+    std::vector<uint16_t> ping;            // (narrow, wide) blur of luminance * 256
+    std::vector<unsigned char> dog;        // 0 or 1
+    std::vector<int8_t> sobel;             // PS_HorizontalSobel (Gx, Gy) of the 0/1 edges
+    std::vector<int> cellEdges;            // winning edge direction per cell, -1 for none
+    DogWeights dogWeights;
+    std::vector<uint16_t> taps;            // dogWeights in 0.16 fixed point
+};
+
+// Every stage up to the per-cell edge vote, in 8- and 16-bit integers: u8
+// luminance, u16 blur accumulators, i8 Sobel gradients and a lookup table
+// in place of atan2. There is no depth input; this is the image path.
+void runFixedAnalysis(const CpuImage& input, const AsciiParams& params, ThreadPool& pool,
+                      FixedIntermediates& buffers);
+
+void runFixedPipeline(const CpuImage& input, const AsciiParams& params, const GlyphAtlas& edgesAtlas,
+                      const GlyphAtlas& fillAtlas, ThreadPool& pool, FixedIntermediates& buffers,
+                      std::vector<unsigned char>& output);
+
+// How far the fixed-point result is from runCpuPipeline on the same image.
+struct FixedErrorReport {
+    double dogMismatch = 0.0;    // fraction of pixels whose DoG bit differs
+    double cellMismatch = 0.0;   // fraction of cells with a different edge direction
+    double pixelMismatch = 0.0;  // fraction of output pixels that differ
+    int maxChannelError = 0;     // largest difference of any output byte
+};
+
+// Leaves the fixed-point run in fixedBuffers and fixedOutput, as
+// runFixedPipeline would, so the caller can write it without a second run.
+FixedErrorReport measureFixedError(const CpuImage& input, const AsciiParams& params, const GlyphAtlas& edgesAtlas,
+                                   const GlyphAtlas& fillAtlas, ThreadPool& pool, FixedIntermediates& fixedBuffers,
+                                   std::vector<unsigned char>& fixedOutput);
+
+// processFrameCPU with the fixed-point analysis; buffers is kept across
+// frames in the same way. With compare set, also runs the float pipeline
+// and prints the error report.
+bool processFrameFixed(const CpuImage& input, const char* outputPath, OutputFormat format, const AsciiParams& params,
+                       const GlyphAtlas& edgesAtlas, const GlyphAtlas& fillAtlas, ThreadPool& pool,
+                       FixedIntermediates& buffers, ImageWriter& writer, bool compare);
+
+#endif
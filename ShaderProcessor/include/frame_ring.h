@@ -0,0 +1,110 @@
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+// Bounded ring between pipeline stages, carrying one value per frame. It is
+// Vyukov's bounded queue with the frame index as the ticket: each slot holds
+// an atomic sequence number, put(i) waits until the slot is free for frame i
+// (frame i - capacity has been taken) and take(i) until frame i is in it.
+// The sequence counts both states, 2i free and 2i + 1 full, so even a single
+// slot never mistakes frame i for the free slot of frame i + 1. So
+// however many threads fill or drain it, frames pass in index order, and no
+// lock is taken while the other side keeps up. A thread with nothing to do
+// yields for a while, then sleeps on a condition variable that put and take
+// signal only when someone sleeps on it, so it wakes as soon as its slot is
+// ready. close() ends every wait, which then returns false.
+template <typename T>
+class FrameRing {
+public:
+    explicit FrameRing(size_t capacity)
+        : capacity(capacity > 0 ? capacity : 1), slots(new Slot[this->capacity]) {
+        for (size_t i = 0; i < this->capacity; ++i) slots[i].sequence.store(2 * i, std::memory_order_relaxed);
+    }
+
+    FrameRing(const FrameRing&) = delete;
+    FrameRing& operator=(const FrameRing&) = delete;
+
+    bool put(size_t index, T value) {
+        Slot& slot = slots[index % capacity];
+        if (!waitFor(slot, 2 * index)) return false;
+        slot.value = std::move(value);
+        slot.sequence.store(2 * index + 1);
+        wake();
+        return true;
+    }
+
+    bool take(size_t index, T& value) {
+        Slot& slot = slots[index % capacity];
+        if (!waitFor(slot, 2 * index + 1)) return false;
+        value = std::move(slot.value);
+        slot.sequence.store(2 * (index + capacity));
+        wake();
+        return true;
+    }
+
+    // Waits until put(index) would not, so a producer can claim the slot
+    // before it builds the value. False once closed.
+    bool reserve(size_t index) {
+        return waitFor(slots[index % capacity], 2 * index);
+    }
+
+    // True once frame index is in the ring, without waiting.
+    bool ready(size_t index) const {
+        return slots[index % capacity].sequence.load(std::memory_order_acquire) == 2 * index + 1;
+    }
+
+    void close() {
+        closed.store(true, std::memory_order_release);
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        wakeup.notify_all();
+    }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    bool waitFor(const Slot& slot, size_t sequence) {
+        auto arrived = [&] { return slot.sequence.load(std::memory_order_acquire) == sequence; };
+        for (int spins = 0; !arrived(); ++spins) {
+            if (closed.load(std::memory_order_acquire)) return false;
+            if (spins < 64) {
+                std::this_thread::yield();
+                continue;
+            }
+            // Sequence stores, this count and the loads below are all
+            // sequentially consistent, so either wake() sees this thread in
+            // sleepers or the predicate sees the sequence it stored.
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleepers.fetch_add(1);
+            wakeup.wait(lock, [&] { return slot.sequence.load() == sequence || closed.load(); });
+            sleepers.fetch_sub(1);
+        }
+        return true;
+    }
+
+    // Called after every sequence store. With both sides keeping up nobody
+    // sleeps, and the lock is never taken.
+    void wake() {
+        if (sleepers.load() == 0) return;
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        wakeup.notify_all();
+    }
+
+    const size_t capacity;
+    std::unique_ptr<Slot[]> slots;
+    std::atomic<bool> closed{false};
+    std::atomic<int> sleepers{0};
+    std::mutex sleepMutex;
+    std::condition_variable wakeup;
+};
+
+#endif
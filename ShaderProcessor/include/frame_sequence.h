@@ -0,0 +1,36 @@
+#ifndef FRAME_SEQUENCE_H
+#define FRAME_SEQUENCE_H
+
+#include <string>
+#include <vector>
+
+// Numbered image sequences as ffmpeg writes them: a path with one printf
+// frame number, %d or %0Nd (data/frame%04d.png), names frames 1, 2, ... or
+// 0, 1, ... up to the first missing file. A directory or a glob names its
+// files in order of their names.
+struct FrameSequence {
+    std::vector<std::string> inputs;
+    std::vector<std::string> outputs;  // same numbers, in the output pattern
+};
+
+// True if path holds a frame number field.
+bool isSequencePattern(const std::string& path);
+
+// pattern with its frame number field replaced by index.
+std::string sequencePath(const std::string& pattern, int index);
+
+// Finds the frames of inputPattern. An output path without a frame number
+// gets one in front of its extension (output.png becomes output%04d.png).
+// False, with a message, when there is no first frame.
+bool expandSequence(const std::string& inputPattern, const std::string& outputPath, FrameSequence& sequence);
+
+// True if path is a directory or holds a glob wildcard (*, ? or [).
+bool isFileList(const std::string& path);
+
+// The images in a directory (by extension, those stb_image reads), or the
+// files a glob matches, sorted by name. Outputs are numbered from 1 in the
+// output pattern, completed as by expandSequence. False, with a message,
+// when there are none.
+bool expandFileList(const std::string& input, const std::string& outputPath, FrameSequence& sequence);
+
+#endif
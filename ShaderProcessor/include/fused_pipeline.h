@@ -0,0 +1,32 @@
+#ifndef FUSED_PIPELINE_H
+#define FUSED_PIPELINE_H
+
+#include <vector>
+#include "ascii_params.h"
+#include "cpu_pipeline.h"
+
+// Size of a fused tile in 8x8 cells. With the default blur radius a tile's
+// scratch (luminance and ping rows plus halo) is around 200 KB, inside L2,
+// and the vertical halo adds under a fifth to the rows blurred.
+const int FUSED_TILE_CELLS = 32;
+const int FUSED_TILE_CELL_ROWS = 4;
+
+// Same output as runCpuPipeline, bit for bit, computed one tile at a time:
+// FUSED_TILE_CELLS x FUSED_TILE_CELL_ROWS cells plus the halo their stencils
+// read (the blur radius and one Sobel tap on each side). Every intermediate
+// lives in per-band scratch sized to a tile, so output is the only full-frame
+// buffer written. There is no depth input; this is the image path.
+void runFusedPipeline(const CpuImage& input, const AsciiParams& params, const GlyphAtlas& edgesAtlas,
+                      const GlyphAtlas& fillAtlas, ThreadPool& pool, std::vector<unsigned char>& output);
+
+// The same tiles stopping at the edge vote: the per-cell results runCpuAnalysis
+// leaves in CpuIntermediates, for writeCellText.
+void runFusedCells(const CpuImage& input, const AsciiParams& params, ThreadPool& pool, std::vector<int>& cellEdges,
+                   std::vector<float>& downscale);
+
+// processFrameCPU with the fused tiles.
+bool processFrameFused(const CpuImage& input, const char* outputPath, OutputFormat format, const AsciiParams& params,
+                       const GlyphAtlas& edgesAtlas, const GlyphAtlas& fillAtlas, ThreadPool& pool,
+                       ImageWriter& writer);
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef GL_CONTEXT_H
+#define GL_CONTEXT_H
+
+struct GLFWwindow;
+
+// The OpenGL context the GL backend renders with, current on the calling
+// thread. Every pass renders into its own FBO, so no window is needed: the
+// default is an EGL context with no surface at all, and a GLFW window is
+// only opened to preview the result.
+struct GLContext {
+    void* eglDisplay = nullptr;
+    void* eglContext = nullptr;
+    void* eglSurface = nullptr;  // 1x1 pbuffer, only without EGL_KHR_surfaceless_context
+    GLFWwindow* window = nullptr;
+};
+
+// Offscreen context through EGL, OpenGL 4.3 core or else 3.3 core. Tries the
+// devices of EGL_EXT_device_enumeration in order (or only device, if it is
+// not negative), then Mesa's surfaceless platform, then the default display.
+bool createHeadlessContext(GLContext& context, int device);
+
+// Context of a visible GLFW window. Fails when built without GLFW.
+bool createWindowContext(GLContext& context, int width, int height);
+
+// Shows the image at path in the window until it is closed.
+void runPreview(GLContext& context, const char* path);
+
+void destroyGLContext(GLContext& context);
+
+// Whether the current GL context lists the extension in GL_EXTENSIONS.
+bool hasGLExtension(const char* name);
+
+#endif
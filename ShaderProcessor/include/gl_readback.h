@@ -0,0 +1,67 @@
+#ifndef GL_READBACK_H
+#define GL_READBACK_H
+
+#include <KHR/khrplatform.h>
+#include <glad/glad.h>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// Receives a finished frame: width * height RGBA8 pixels, top row first,
+// valid only for the duration of the call.
+using GLReadbackCallback = std::function<void(const unsigned char* rgba, int width, int height)>;
+
+// Asynchronous glReadPixels through a ring of pixel buffer objects. queue()
+// only records the copy into the next buffer and a fence behind it, so
+// processFrame returns while the GPU is still rendering; the frame is mapped
+// and handed to its callback once its fence has signalled, at the latest
+// when its buffer is needed again depth frames later. A sequence therefore
+// encodes frame N on the CPU while frame N+1 renders.
+class GLReadbackRing {
+public:
+    explicit GLReadbackRing(int depth = 3) : slots(depth < 1 ? 1 : depth) {}
+    ~GLReadbackRing() = default;
+
+    GLReadbackRing(const GLReadbackRing&) = delete;
+    GLReadbackRing& operator=(const GLReadbackRing&) = delete;
+
+    // Starts reading width x height RGBA8 from the bound read framebuffer.
+    void queue(int width, int height, GLReadbackCallback callback);
+
+    // Starts reading every layer of an RGBA8 GL_TEXTURE_2D_ARRAY in one copy.
+    // The callback sees the layers one below the other, as an image of
+    // width x (height * layers).
+    void queueLayers(unsigned int texture, int width, int height, int layers, GLReadbackCallback callback);
+
+    // Hands over every frame whose fence has already signalled, oldest first.
+    void poll();
+
+    // Waits for and hands over every queued frame.
+    void flush();
+
+    // Flushes, then deletes the buffers and fences; needs the context still current.
+    void clear();
+
+    int depth() const { return static_cast<int>(slots.size()); }
+
+private:
+    struct Slot {
+        unsigned int buffer = 0;
+        size_t capacity = 0;
+        GLsync fence = nullptr;
+        int width = 0;
+        int height = 0;
+        GLReadbackCallback callback;
+    };
+
+    void bindSlot(size_t bytes);
+    void submit(int width, int height, GLReadbackCallback callback);
+    void finish(Slot& slot);
+
+    std::vector<Slot> slots;
+    size_t next = 0;    // slot the next queue() writes
+    size_t oldest = 0;  // oldest slot still pending
+    size_t pending = 0;
+};
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef GLYPH_ATLAS_H
+#define GLYPH_ATLAS_H
+
+#include <cstdint>
+#include <vector>
+
+// edgesASCII.png / fillASCII.png as one-bit glyphs: a row of 8x8 glyphs, each
+// packed into a 64-bit mask with bit y * 8 + x set where the red channel the
+// shaders read (ascii.r) is lit. Row 0 is the top row of the atlas.
+struct GlyphAtlas {
+    int width = 0;
+    int height = 0;
+    std::vector<uint64_t> masks;
+
+    int glyphCount() const { return static_cast<int>(masks.size()); }
+    // Glyph index clamped to the atlas, as the clamping sampler would.
+    uint64_t glyph(int index) const;
+};
+
+inline bool glyphBit(uint64_t glyph, int x, int y) {
+    return (glyph >> (y * 8 + x)) & 1;
+}
+
+bool loadGlyphAtlas(const char* path, GlyphAtlas& atlas);
+
+#endif
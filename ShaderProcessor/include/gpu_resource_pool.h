@@ -0,0 +1,79 @@
+#ifndef GPU_RESOURCE_POOL_H
+#define GPU_RESOURCE_POOL_H
+
+#include <KHR/khrplatform.h>
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// How a pooled texture is used, part of its key: textures of the same size
+// and format are only handed out again for the same kind of use.
+enum class GLTextureUsage {
+    RenderTarget,  // FBO attachment, sampled by later passes
+    Storage,       // image2D written by a compute shader
+    Upload,        // filled from the CPU, the source image
+};
+
+// Textures and the framebuffer that processFrame would otherwise create and
+// delete on every call. A released texture stays allocated and is handed out
+// again for the next request with the same (width, height, layers, format,
+// usage), so
+// a sequence of frames at one resolution allocates only for the first frame.
+// Idle textures are deleted, least recently used first, when the pool grows
+// past its budget.
+class GLResourcePool {
+public:
+    // budgetBytes caps allocated texture memory; 0 means no cap.
+    explicit GLResourcePool(size_t budgetBytes = 0) : budget(budgetBytes) {}
+    ~GLResourcePool() = default;
+
+    GLResourcePool(const GLResourcePool&) = delete;
+    GLResourcePool& operator=(const GLResourcePool&) = delete;
+
+    // layers > 1 gives a GL_TEXTURE_2D_ARRAY, for frame batches.
+    unsigned int acquireTexture(int width, int height, GLenum internalFormat, GLTextureUsage usage, int layers = 1);
+    void releaseTexture(unsigned int texture);
+
+    // The one FBO every pass attaches its target to.
+    unsigned int framebuffer();
+
+    void setBudget(size_t budgetBytes);
+    size_t allocatedBytes() const { return allocated; }
+    size_t idleBytes() const;
+
+    // Prints the textures held, their memory and how many requests were reused.
+    void printFootprint() const;
+
+    // Deletes every texture and the framebuffer; needs the context still current.
+    void clear();
+
+private:
+    struct Entry {
+        unsigned int texture;
+        int width;
+        int height;
+        int layers;
+        GLenum internalFormat;
+        GLTextureUsage usage;
+        size_t bytes;
+        bool inUse;
+        uint64_t lastUsed;
+    };
+
+    void evictIdle(size_t incomingBytes);
+    void deleteEntry(size_t index);
+
+    std::vector<Entry> entries;
+    unsigned int fbo = 0;
+    size_t budget;
+    size_t allocated = 0;
+    uint64_t clock = 0;
+    uint64_t allocations = 0;
+    uint64_t reuses = 0;
+};
+
+// Bytes per texel of a sized internal format, 0 for formats the pool does not use.
+size_t glFormatBytes(GLenum internalFormat);
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef IMAGE_INPUT_H
+#define IMAGE_INPUT_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "frame_ring.h"
+
+// An image as stb_image decodes it: width x height pixels of channels bytes,
+// top row first. Freed with the object; pixels is null if decoding failed.
+struct DecodedImage {
+    unsigned char* pixels = nullptr;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+
+    DecodedImage() = default;
+    ~DecodedImage();
+    DecodedImage(DecodedImage&& other) noexcept;
+    DecodedImage& operator=(DecodedImage&& other) noexcept;
+    DecodedImage(const DecodedImage&) = delete;
+    DecodedImage& operator=(const DecodedImage&) = delete;
+
+    void reset();
+};
+
+// Maps path into memory and decodes it from there with stbi_load_from_memory,
+// so the file is read once, by the page cache, with no buffered copy.
+// desiredChannels as for stbi_load, 0 for the file's own. False, with a
+// message, if the file cannot be read or decoded.
+bool loadImage(const std::string& path, DecodedImage& image, int desiredChannels = 0);
+
+// The decode stage of a sequence: worker threads decode the files in order
+// of the list, each taking the next file no other has, and pass the images
+// through a FrameRing of depth slots, so next() gets them in list order.
+// A worker reserves its slot before decoding, so at most depth images are
+// held decoded or being decoded, besides those next() has handed out; for
+// the same reason there are never more workers than slots. While a worker
+// decodes one file, the kernel is asked (madvise WILLNEED) to read in the
+// file it or another worker will take next. With depth 0 there are no
+// threads, and next() decodes on the caller's.
+class ImageReadAhead {
+public:
+    // threads decode workers, 0 for one per hardware thread; at most depth.
+    ImageReadAhead(const std::vector<std::string>& paths, int depth, unsigned int threads, int desiredChannels = 0);
+    ~ImageReadAhead();
+
+    ImageReadAhead(const ImageReadAhead&) = delete;
+    ImageReadAhead& operator=(const ImageReadAhead&) = delete;
+
+    // The next image of the list, waiting for it if need be; its pixels are
+    // null if it failed to load. False once every image has been taken.
+    bool next(DecodedImage& image);
+
+    unsigned int threadCount() const { return static_cast<unsigned int>(workers.size()); }
+    // Time next() has spent waiting for a worker.
+    double waitSeconds() const { return waited; }
+
+private:
+    void decodeLoop();
+
+    std::vector<std::string> paths;
+    int desiredChannels;
+    size_t workerCount = 0;
+    size_t taken = 0;
+    double waited = 0.0;
+    std::atomic<size_t> claimed{0};
+    std::unique_ptr<FrameRing<DecodedImage>> ring;  // null without read-ahead
+    std::vector<std::thread> workers;
+};
+
+#endif
@@ -1,10 +1,154 @@
 #ifndef IMAGE_PROCESSOR_H
 #define IMAGE_PROCESSOR_H
 
+#include <cstdint>
 #include "shader.h"
+#include "ascii_params.h"
+#include "cell_text.h"
+#include "dog_weights.h"
+#include "glyph_atlas.h"
+#include "gpu_resource_pool.h"
+#include "gl_readback.h"
+#include "image_input.h"
+#include "image_writer.h"
 
-void processImage(const char* inputPath, const char* outputPath, Shader& shader, unsigned int edgesASCIITexture, unsigned int fillASCIITexture, Shader* computeShader = nullptr);
+// Full-screen passes of ASCII.fx, in execution order. Each one is its own
+// program writing only the channels of its render target.
+enum GLPass {
+    PASS_LUMINANCE,
+    PASS_DOWNSCALE,
+    PASS_HORIZONTAL_BLUR,
+    PASS_VERTICAL_BLUR,
+    PASS_CALCULATE_NORMALS,
+    PASS_EDGE_DETECT,
+    PASS_HORIZONTAL_SOBEL,
+    PASS_VERTICAL_SOBEL,
+    PASS_END,
+    GL_PASS_COUNT
+};
+
+// Float precision of the continuous render targets (luminance, blur, cell
+// averages, Sobel angles). Half reads and writes half the bytes of full;
+// full reproduces the CPU backend exactly.
+enum class GLPrecision {
+    Half,
+    Full,
+};
+
+// CPU copy of the std140 AsciiParams uniform block in ascii_params.glsl,
+// member for member. Bools are 32-bit words; each uvec2 array element takes
+// a 16-byte slot, of which the first two words hold the glyph mask.
+struct GLParamsBlock {
+    float asciiColor[3];
+    float blendWithBase;
+    float backgroundColor[3];
+    float exposure;
+    float offset[2];
+    float zoom;
+    float attenuation;
+    float tau;
+    float threshold;
+    float depthThreshold;
+    float normalThreshold;
+    float depthCutoff;
+    float depthFalloff;
+    float depthOffset;
+    int32_t edgeThreshold;
+    uint32_t edges;
+    uint32_t fill;
+    uint32_t invertLuminance;
+    uint32_t useDepth;
+    uint32_t useNormals;
+    uint32_t pad[3];
+    uint32_t edgesGlyphs[5][4];
+    uint32_t fillGlyphs[10][4];
+};
+static_assert(sizeof(GLParamsBlock) == 352, "GLParamsBlock must match the std140 AsciiParams block");
+
+// Binding point of the AsciiParams uniform buffer.
+const unsigned int GL_PARAMS_BINDING = 0;
+
+// Programs and assets that outlive a single processFrame call. dogWeights
+// remembers the taps last uploaded, so the blur uniforms are only rewritten
+// when _Sigma, _SigmaScale or _KernelSize change. The glyph atlases reach the
+// ASCII program as bitmask uniforms rather than textures. resources keeps the
+// render targets and framebuffer from one call to the next. paramsBuffer
+// holds every other parameter for all programs at once; paramsBlock is what
+// it was last given, so an unchanged frame uploads nothing. readback holds
+// frames whose pixels are still on their way back from the GPU; writer then
+// saves them, encoding PNGs off the GL thread.
+struct GLPipeline {
+    Shader* passes[GL_PASS_COUNT] = {};
+    Shader* computeShader = nullptr;   // CS_RenderASCII, GL 4.3 and up
+    int subgroupMode = -1;             // ballot vote: 1 wherever supported, 0 never, -1 where it is faster
+    bool subgroupVote = false;         // computeShader is ascii_compute_ballot.glsl
+    Shader* fallbackShader = nullptr;  // fragment version of CS_RenderASCII otherwise
+    Shader* analysisShader = nullptr;  // luminance to Sobel in one tiled dispatch, GL 4.3 and up
+    bool fragmentAnalysis = false;     // run the fragment passes even where analysisShader exists
+    int batchSize = 1;                 // frames per processBatch; above 1 createGLPipeline builds:
+    Shader* batchDownscale = nullptr;  //   PS_Downscale,
+    Shader* batchAnalysis = nullptr;   //   the analysis
+    Shader* batchCompute = nullptr;    //   and CS_RenderASCII over texture array layers
+    GlyphAtlas edgesAtlas;
+    GlyphAtlas fillAtlas;
+    DogWeights dogWeights;
+    GLResourcePool resources;
+    GLReadbackRing readback;
+    ImageWriter* writer = nullptr;  // must be set before the first frame
+    GLPrecision precision = GLPrecision::Half;
+    int glyphBenchmarkRuns = 0;  // extra timed CS_RenderASCII dispatches per image
+    int plannedWidth = 0;   // size the render graph was last printed for
+    int plannedHeight = 0;
+    int plannedLayers = 0;
+    unsigned int paramsBuffer = 0;
+    GLParamsBlock paramsBlock = {};
+    bool paramsUploaded = false;
+};
+
+// Compiles every pass program, plus the compute ASCII and analysis programs
+// or the fallback ASCII program, and the batch programs if batchSize > 1.
+// precision must already be set.
+void createGLPipeline(GLPipeline& pipeline, bool useCompute);
+// Writes any pending frames, then frees the pooled resources after printing
+// their footprint.
+void destroyGLPipeline(GLPipeline& pipeline);
+
+// Renders width x height pixels of channels bytes each, which may be reused
+// once this returns, to an image, or for the text formats runs the passes up
+// to the edge vote and writes only the character grid. The image is written
+// asynchronously: it exists once flushGLReadbacks or destroyGLPipeline has
+// returned, or the writer has got to it. Text output is read back and
+// written immediately. Returns false if the text grid could not be made or
+// written; a failed image write shows in flushGLReadbacks.
+bool processFrame(const unsigned char* pixels, int width, int height, int channels, const char* outputPath,
+                  OutputFormat format, GLPipeline& pipeline, const AsciiParams& params);
+
+// Renders up to batchSize image frames of one size as a batch: the frames go
+// into the layers of one texture array, each pass runs once over all of them
+// as a compute dispatch with one z per frame, and the results come back in a
+// single readback. Frames should be decoded straight to RGBA, which gives
+// greyscale and RGB frames the colours processFrame's swizzle does, since
+// one texture array has one swizzle. The batch ends early at a frame of
+// another size or one that failed to load. Needs the batch programs (GL 4.3,
+// compute analysis); otherwise, or for a batch of one, the first frame goes
+// through processFrame, and rendered is what that returned. Returns how many
+// frames were consumed. The output directory must already exist.
+int processBatch(const DecodedImage* images, const std::string* outputPaths, int count, GLPipeline& pipeline,
+                 const AsciiParams& params, bool& rendered);
+
+// Waits for every queued image frame to be read back and written. Returns
+// false if any write failed since the last flush.
+bool flushGLReadbacks(GLPipeline& pipeline);
+
+// Uploads _BlurWeights and _KernelSize to every program that blurs, if they changed.
+void updateBlurWeights(GLPipeline& pipeline, const AsciiParams& params);
+// Rewrites the AsciiParams uniform buffer, if anything in it changed.
+void updateParamsBlock(GLPipeline& pipeline, const AsciiParams& params, bool hasDepth);
 
 unsigned int createTexture(int width, int height, GLenum internalFormat);
+// GL_TEXTURE_2D_ARRAY of layers frames, for batches; needs GL 4.2 storage.
+unsigned int createTextureArray(int width, int height, int layers, GLenum internalFormat);
+
+void createOutputDirectory(const std::string& path);
 
-#endif
\ No newline at end of file
+#endif
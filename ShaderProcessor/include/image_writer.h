@@ -0,0 +1,112 @@
+#ifndef IMAGE_WRITER_H
+#define IMAGE_WRITER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "frame_ring.h"
+#include "thread_pool.h"
+#include "video_stream.h"
+
+// File formats for the rendered image. All but PNG skip compression, for
+// output that goes straight into another tool: QOI is a byte-aligned run and
+// delta code, PPM and PAM are the netpbm formats, RGB and RGBA headerless
+// rows. RGBA and PAM keep a fourth channel, always 255.
+enum class ImageFormat {
+    PNG,
+    QOI,
+    PPM,
+    PAM,
+    RGB,
+    RGBA,
+};
+
+// Format named by the extension of path (.qoi, .ppm, .pam, .rgb, .rgba), PNG otherwise.
+ImageFormat imageFormatForPath(const std::string& path);
+// Parses png, qoi, ppm, pam, rgb or rgba; returns false for anything else.
+bool parseImageFormat(const char* name, ImageFormat& format);
+const char* imageFormatExtension(ImageFormat format);
+
+// Encodes width x height RGB or RGBA pixels (channels 3 or 4, alpha
+// ignored) as QOI with three channels.
+void encodeQOI(const unsigned char* pixels, int width, int height, int channels, std::vector<unsigned char>& qoi);
+
+// Writes images in one format; the encode stage of a sequence. Images to
+// encode go through a one-slot FrameRing to the writer's encoder threads,
+// each taking the next image in order, so whoever produces them never waits
+// on compression unless every encoder is busy and one more image is queued.
+// That is also the most it holds: one image per encoder and one waiting.
+// PNG deflate groups are also spread over a pool of as many threads.
+// Each file is reported on the console once it has been written. write is
+// called from one thread, in frame order.
+class ImageWriter {
+public:
+    // pngLevel as for encodePNG; threads is the number of writer threads, 0
+    // for one per hardware thread.
+    ImageWriter(ImageFormat format, int pngLevel, unsigned int threads);
+    ~ImageWriter();
+
+    ImageWriter(const ImageWriter&) = delete;
+    ImageWriter& operator=(const ImageWriter&) = delete;
+
+    ImageFormat format() const { return imageFormat; }
+
+    // Sends every image to stream instead of a file, in the order written;
+    // paths are ignored. The frames are converted and written on the encoder
+    // threads, one after another. nullptr goes back to files.
+    void setStream(VideoStreamWriter* stream) { videoStream = stream; }
+
+    // Takes width x height pixels of channels bytes each (3 for RGB, or 4 for
+    // RGBA read back from the GPU) and queues the file.
+    void write(const std::string& path, std::vector<unsigned char> pixels, int width, int height, int channels);
+
+    // The same for pixels that are only valid during the call, such as a
+    // mapped readback buffer. They are copied and queued like any other
+    // image, so the caller does not wait on encoding or the file.
+    void write(const std::string& path, const unsigned char* pixels, int width, int height, int channels);
+
+    // Waits for every queued file. Returns false if any write failed since
+    // the last flush.
+    bool flush();
+
+    unsigned int threadCount() const { return static_cast<unsigned int>(encoders.size()); }
+    // Time write has spent waiting for a free slot.
+    double waitSeconds() const { return waited; }
+
+private:
+    struct Job {
+        std::string path;
+        std::vector<unsigned char> pixels;
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        VideoStreamWriter* stream = nullptr;  // set for a stream frame
+        size_t streamFrame = 0;               // its place in the stream
+    };
+
+    void encodeLoop();
+    bool writeFile(const std::string& path, const unsigned char* pixels, int width, int height, int channels);
+    void report(const std::string& path, bool ok);
+
+    ImageFormat imageFormat;
+    int pngLevel;
+    VideoStreamWriter* videoStream = nullptr;
+    size_t submitted = 0;
+    size_t streamFrames = 0;
+    double waited = 0.0;
+    std::atomic<size_t> claimed{0};
+    size_t completed = 0;  // guarded by completedMutex, as is streamed
+    size_t streamed = 0;
+    std::mutex completedMutex;
+    std::condition_variable progress;
+    std::atomic<bool> failed{false};
+    FrameRing<Job> jobs;
+    ThreadPool pool;
+    std::vector<std::thread> encoders;
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <string>
+#include "cell_text.h"
+#include "image_processor.h"
+#include "image_writer.h"
+#include "png_encoder.h"
+
+enum class Backend {
+    GL,
+    CPU,
+    Fused,  // CPU, cache-blocked tiles with no full-frame intermediates
+    Fixed,  // CPU, 8/16-bit fixed-point arithmetic
+};
+
+struct Options {
+    Backend backend = Backend::GL;
+    unsigned int threads = 0;  // CPU backends' worker count, 0 = all hardware threads
+    std::string simd;          // caps the CPU kernel level (scalar, sse4.1, avx2, avx512)
+    OutputFormat format = OutputFormat::Image;
+    ImageFormat imageFormat = ImageFormat::PNG;  // from --format, else the output path's extension
+    int pngLevel = 3;          // PNG compression, 0 stored, 1 RLE, 2-9 LZ77 effort
+    unsigned int writerThreads = 0;  // image writer threads, 0 = all hardware threads
+    int device = -1;           // EGL device for the GL backend, -1 for the first that works
+    GLPrecision precision = GLPrecision::Half;  // float render targets of the GL backend
+    bool fragmentPasses = false;  // GL analysis as separate fragment passes even on GL 4.3
+    int subgroups = -1;        // subgroup ballot vote in CS_RenderASCII: 1 forced, 0 off, -1 by driver
+    int benchGlyph = 0;        // time this many extra CS_RenderASCII dispatches
+    int readAhead = 2;         // input files decoded ahead of the frame being processed
+    unsigned int decodeThreads = 0;  // input decoder threads, 0 = all hardware threads
+    int batch = 1;             // GL frames rendered together through texture arrays
+    unsigned int gpuBudget = 0;  // MB of pooled GL textures to keep, 0 = no cap
+    std::string programCache = "../cache/";  // linked GL program binaries, empty to always compile
+    bool preview = false;      // render in a GLFW window and show the result there
+    bool stream = false;       // frames from stdin to stdout instead of files
+    int streamWidth = 0;       // raw rgb24 frame size for --stream; 0 reads Y4M
+    int streamHeight = 0;
+    bool compare = false;      // with the fixed backend, also report the error against the float pipeline
+    std::string inputPath = "../assets/frame1358.png";  // or a sequence: frame%04d.png, a directory or a glob
+    std::string outputPath = "../output/output.png";  // extension follows --format by default
+};
+
+// Parses the command line into options. Prints usage and returns false on
+// --help or on an argument it does not understand.
+bool parseOptions(int argc, char** argv, Options& options);
+
+#endif
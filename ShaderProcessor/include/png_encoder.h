@@ -0,0 +1,24 @@
+#ifndef PNG_ENCODER_H
+#define PNG_ENCODER_H
+
+#include <vector>
+#include "thread_pool.h"
+
+// Compression levels of encodePNG. Stored writes the rows uncompressed, RLE
+// only encodes runs of a repeated byte; from 2 up each level follows LZ77
+// hash chains twice as far as the one below and from 4 up matches lazily.
+const int PNG_LEVEL_STORED = 0;
+const int PNG_LEVEL_RLE = 1;
+const int PNG_LEVEL_MAX = 9;
+
+// Encodes width x height pixels of channels bytes each (3 for RGB, or 4 for
+// RGBA read back from the GPU, whose alpha is dropped) as an 8-bit RGB PNG.
+// Rows are filtered in parallel on pool, then deflated in groups of about
+// 128 KB, one task per group. Each group's matches may reach back into the
+// rows before it, and it ends on a byte boundary, so the groups concatenate
+// into one zlib stream; each becomes its own IDAT chunk. The output does not
+// depend on the number of threads.
+void encodePNG(const unsigned char* pixels, int width, int height, int channels, int level, ThreadPool& pool,
+               std::vector<unsigned char>& png);
+
+#endif
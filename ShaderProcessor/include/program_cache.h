@@ -0,0 +1,39 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <cstdint>
+#include <string>
+
+// Linked program binaries on disk, so a warm start skips the GLSL compiler.
+// Entries are named by a hash of everything the driver compiled: the source
+// of each stage after #include expansion (defines included, since they are
+// part of that text) and the GL vendor, renderer and version strings. A
+// binary the driver rejects is simply recompiled and overwritten. Needs GL
+// 4.1 and a driver that exposes at least one program binary format;
+// otherwise every program is compiled as before.
+
+// Empty disables the cache. The directory is created on first store.
+void setProgramCacheDirectory(const std::string& directory);
+
+struct ProgramCacheStats {
+    int loaded = 0;    // programs restored from a binary
+    int compiled = 0;  // programs built from source
+    int stored = 0;    // binaries written after a compile
+};
+
+const ProgramCacheStats& programCacheStats();
+
+// Key for a program built from these stage sources on the current context.
+uint64_t programCacheKey(const std::string* sources, int count);
+
+// Restores program from the cache. False if there is no entry or the driver
+// no longer accepts it; program is then still unlinked and can be compiled.
+bool loadProgramBinary(unsigned int program, uint64_t key);
+
+// Call before glLinkProgram so the driver keeps the binary retrievable.
+void prepareProgramBinary(unsigned int program);
+
+// Writes a successfully linked program's binary under key.
+void storeProgramBinary(unsigned int program, uint64_t key);
+
+#endif
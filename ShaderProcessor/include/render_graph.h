@@ -0,0 +1,95 @@
+#ifndef RENDER_GRAPH_H
+#define RENDER_GRAPH_H
+
+#include <KHR/khrplatform.h>
+#include <glad/glad.h>
+#include <functional>
+#include <string>
+#include <vector>
+#include "gpu_resource_pool.h"
+
+// One frame of GL passes declared as data: each pass names the textures it
+// reads and writes, and compile() works out the rest. A pass survives only if
+// it has a side effect (a readback) or writes something a surviving pass
+// reads, so passes whose output the current parameters never use are
+// dropped. Each transient texture lives from its writer to its last reader,
+// and transients whose lifetimes do not overlap share one physical texture
+// when size, format and usage match. Passes run in the order they were added.
+class RenderGraph {
+public:
+    // A transient texture, allocated from the pool while the graph runs and
+    // written by exactly one pass; an array texture when layers > 1.
+    int createTexture(const char* name, int width, int height, GLenum internalFormat, GLTextureUsage usage,
+                      int layers = 1);
+    // A texture the caller owns, such as the uploaded source image.
+    int importTexture(const char* name, unsigned int texture, int width, int height, GLenum internalFormat,
+                      int layers = 1);
+
+    int addPass(const char* name, std::function<void()> execute, bool sideEffect = false);
+    // fetches is the number of texels read per texel the pass writes, only
+    // used for the traffic estimate.
+    void read(int pass, int texture, double fetches = 1.0);
+    void write(int pass, int texture);
+
+    // Culls passes and assigns physical textures.
+    void compile();
+    // Acquires the physical textures from pool, runs the surviving passes
+    // and hands the textures back.
+    void execute(GLResourcePool& pool);
+
+    // GL name behind a handle while execute() runs, 0 for a culled texture.
+    unsigned int texture(int handle) const;
+    GLenum format(int handle) const { return textures[handle].internalFormat; }
+
+    // Prints the surviving and culled passes, the physical texture of each
+    // transient, the memory with and without aliasing and the traffic of
+    // each pass, counting every texel fetch and write once, next to what the
+    // same graph costs with every transient in RGBA32F.
+    void printPlan() const;
+
+private:
+    struct Access {
+        int texture;
+        double fetches;
+    };
+
+    struct Pass {
+        std::string name;
+        std::function<void()> execute;
+        bool sideEffect;
+        bool live = false;
+        std::vector<Access> reads;
+        std::vector<int> writes;
+    };
+
+    struct Texture {
+        std::string name;
+        int width;
+        int height;
+        int layers;
+        GLenum internalFormat;
+        GLTextureUsage usage;
+        unsigned int imported;  // GL name of an imported texture, 0 for transients
+        int writer = -1;
+        int lastRead = -1;
+        int physical = -1;      // index into physical, -1 if culled or imported
+    };
+
+    struct Physical {
+        int width;
+        int height;
+        int layers;
+        GLenum internalFormat;
+        GLTextureUsage usage;
+        int lastUse;            // last pass of the texture currently assigned
+        unsigned int texture = 0;
+    };
+
+    size_t textureBytes(const Texture& texture, GLenum internalFormat) const;
+
+    std::vector<Pass> passes;
+    std::vector<Texture> textures;
+    std::vector<Physical> physical;
+};
+
+#endif
@@ -4,6 +4,7 @@
 #include <KHR/khrplatform.h>
 #include <glad/glad.h>
 #include <string>
+#include <unordered_map>
 
 class Shader {
 public:
@@ -11,14 +12,37 @@ public:
 
     Shader(const char* vertexPath, const char* fragmentPath);
     Shader(const char* computePath);
+    // The compute program at computePath with defines ("#define NAME VALUE"
+    // lines) inserted after its #version line, for variants of one source.
+    static Shader* compute(const char* computePath, const std::string& defines);
     void use();
     void setBool(const std::string &name, bool value) const;
     void setInt(const std::string &name, int value) const;
     void setFloat(const std::string &name, float value) const;
     void setVec2(const std::string &name, float x, float y) const;
+    void setIVec2(const std::string &name, int x, int y) const;
     void setVec3(const std::string &name, float x, float y, float z) const;
+    void setVec2Array(const std::string &name, const float* values, int count) const;
+
+    // Location from the table reflected at link time, -1 for a uniform the
+    // program does not use (glUniform ignores it, as before).
+    int uniformLocation(const std::string &name) const;
+    // Points the named uniform block at a GL_UNIFORM_BUFFER binding, if the program has it.
+    void bindUniformBlock(const std::string &name, unsigned int binding) const;
+    // GL_UNIFORM_BLOCK_DATA_SIZE of the block, -1 if the program has none of that name.
+    int uniformBlockSize(const std::string &name) const;
 private:
+    Shader() = default;
+    void buildCompute(const std::string& computeCode);
     void checkCompileErrors(unsigned int shader, std::string type);
+    void reflectUniforms();
+
+    std::unordered_map<std::string, int> uniformLocations;
 };
 
+// Reads a shader file, expanding #include "file" lines (relative to the
+// including file) so programs can share declarations such as uniform blocks.
+// defines go right after the #version line.
+std::string readShaderSource(const std::string& path, const std::string& defines = "");
+
 #endif
\ No newline at end of file
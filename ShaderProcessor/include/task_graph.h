@@ -0,0 +1,63 @@
+#ifndef TASK_GRAPH_H
+#define TASK_GRAPH_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "thread_pool.h"
+
+// A set of tasks with explicit dependencies, run on a ThreadPool by work
+// stealing. Every thread keeps its own deque of ready tasks: it pushes the
+// tasks its own work made ready to the back and takes its next task from
+// there, so a stage usually runs on the thread that just wrote its input.
+// A thread that runs dry steals from the front of another thread's deque.
+// There is no barrier between tasks that do not depend on each other.
+class TaskGraph {
+public:
+    // Returns the id to pass to depend().
+    int add(std::function<void()> body);
+
+    // task does not start before prerequisite has finished.
+    void depend(int task, int prerequisite);
+
+    // Runs every task once and blocks until all are done. The graph must be
+    // acyclic; it can be run again afterwards.
+    void run(ThreadPool& pool);
+
+    size_t size() const { return tasks.size(); }
+
+private:
+    struct Task {
+        std::function<void()> body;
+        std::vector<int> dependents;
+        int prerequisites = 0;
+    };
+
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<int> ready;
+    };
+
+    void workerLoop(size_t worker);
+    bool popTask(size_t worker, int& task);
+    void pushReady(size_t worker, int task);
+    void finishTask(size_t worker, int task);
+    void wakeIdle();
+
+    std::vector<Task> tasks;
+
+    // State of the current run()
+    std::unique_ptr<std::atomic<int>[]> pending;  // unfinished prerequisites per task
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::atomic<int> remaining{0};
+    std::atomic<int> readyCount{0};
+    std::atomic<int> sleeping{0};
+    std::mutex idleMutex;
+    std::condition_variable idle;
+};
+
+#endif
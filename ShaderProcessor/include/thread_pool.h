@@ -0,0 +1,41 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    // threadCount includes the calling thread; 0 uses every hardware thread.
+    explicit ThreadPool(unsigned int threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned int size() const { return static_cast<unsigned int>(workers.size()) + 1; }
+
+    // Splits [begin, end) into bands whose starts are multiples of grain and
+    // runs body(bandBegin, bandEnd) on the pool. Blocks until every band is done.
+    void parallelFor(int begin, int end, int grain, const std::function<void(int, int)>& body);
+
+    // Queues task for a worker thread and returns at once; a pool without
+    // workers runs it on the caller.
+    void submit(std::function<void()> task);
+
+private:
+    void workerLoop();
+    bool runPendingTask();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable taskAvailable;
+    bool stopping = false;
+};
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef VIDEO_STREAM_H
+#define VIDEO_STREAM_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Chroma layouts of YUV4MPEG2 (the C tag). Every 4:2:0 siting reads as Y420.
+enum class ChromaFormat {
+    Y420,
+    Y422,
+    Y444,
+    Mono,
+};
+
+// Frames read from a pipe, as ffmpeg writes them with -f yuv4mpegpipe or
+// -f rawvideo -pix_fmt rgb24. Y4M is 8-bit Y'CbCr in BT.601 limited range,
+// as ffmpeg's yuv4mpegpipe muxer and demuxer assume; each frame is converted
+// to RGB on the way in. Only one frame is held at a time.
+class VideoStreamReader {
+public:
+    // Reads the Y4M stream header from file. False, with a message, when it
+    // is missing or asks for something other than 8-bit 4:2:0, 4:2:2, 4:4:4
+    // or mono progressive frames.
+    bool openY4M(FILE* file);
+    // Raw rgb24 frames of width x height, with no header.
+    bool openRaw(FILE* file, int width, int height);
+
+    // Reads the next frame as width x height RGB. False at the end of the
+    // stream, with a message if it ends inside a frame.
+    bool readFrame(std::vector<unsigned char>& rgb);
+
+    int width() const { return frameWidth; }
+    int height() const { return frameHeight; }
+    bool y4m() const { return isY4M; }
+    ChromaFormat chroma() const { return chromaFormat; }
+    // The header's parameters other than size and chroma (frame rate,
+    // interlacing, aspect ratio, ...), to be passed on to the output.
+    const std::string& streamParameters() const { return parameters; }
+
+private:
+    FILE* input = nullptr;
+    bool isY4M = false;
+    int frameWidth = 0;
+    int frameHeight = 0;
+    ChromaFormat chromaFormat = ChromaFormat::Y420;
+    std::string parameters;
+    std::vector<unsigned char> planes;
+};
+
+// Writes processed frames to a pipe in the format they were read in: Y4M
+// with the reader's header, chroma and parameters, or raw rgb24.
+class VideoStreamWriter {
+public:
+    VideoStreamWriter(FILE* file, const VideoStreamReader& reader);
+
+    // Writes one width x height frame of channels bytes per pixel (3 for
+    // RGB, 4 for RGBA, alpha ignored). The header goes out before the first.
+    bool writeFrame(const unsigned char* pixels, int width, int height, int channels);
+
+private:
+    FILE* output;
+    bool isY4M;
+    ChromaFormat chromaFormat;
+    std::string parameters;
+    bool headerWritten = false;
+    std::vector<unsigned char> planes;
+};
+
+#endif
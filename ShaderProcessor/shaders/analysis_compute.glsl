@@ -0,0 +1,134 @@
+#version 430 core
+layout(local_size_x = 16, local_size_y = 16) in;
+
+// PS_Luminance through PS_VerticalSobel for one 16x16 tile, for images
+// without depth. The luminance of the tile and its halo is computed once into
+// shared memory, both blurs, the DoG threshold and the Sobel read it from
+// there, and only the Sobel result reaches global memory. Each stage uses the
+// expressions of its fragment pass, so the result matches the passes run at
+// full precision. Built with ASCII_BATCH, it reads and writes texture
+// arrays, one frame per layer and per z of the dispatch.
+#ifdef ASCII_BATCH
+layout(rg32f, binding = 0) uniform writeonly image2DArray sobelImage;
+uniform sampler2DArray Source;
+#define LAYER(p) ivec3(p, gl_WorkGroupID.z)
+#else
+layout(rg32f, binding = 0) uniform writeonly image2D sobelImage;
+uniform sampler2D Source;
+#define LAYER(p) (p)
+#endif
+
+uniform int _KernelSize;
+uniform vec2 _BlurWeights[21];
+
+#include "ascii_params.glsl"
+
+const int TILE = 16;
+const int MAX_HALO = 11;  // largest _KernelSize, plus one pixel for the Sobel
+const int SPAN = TILE + 2 * MAX_HALO;
+const int EDGE_SPAN = TILE + 2;
+
+// Indexed from tile - MAX_HALO; only entries inside the image are written,
+// and every read goes through the same clamp as the fragment passes.
+shared float tileLuminance[SPAN * SPAN];
+// Horizontal blur of the rows above, for columns tile - 1 to tile + TILE.
+shared vec2 tileBlur[SPAN * EDGE_SPAN];
+// PS_EdgeDetect output for the tile plus one pixel on each side.
+shared float tileEdges[EDGE_SPAN * EDGE_SPAN];
+
+float luminance(vec3 rgb) {
+    return max(0.00001, dot(rgb, vec3(0.2127, 0.7152, 0.0722)));
+}
+
+vec2 transformUV(vec2 uv) {
+    vec2 zoomUV = uv * 2.0 - 1.0;
+    zoomUV += vec2(-_Offset.x, _Offset.y) * 2.0;
+    zoomUV *= _Zoom;
+    zoomUV = zoomUV * 0.5 + 0.5;
+    return zoomUV;
+}
+
+vec3 sourceColor(ivec2 pixel, ivec2 size) {
+    ivec2 source = ivec2(floor(transformUV((vec2(pixel) + 0.5) / vec2(size)) * vec2(size)));
+    if (any(lessThan(source, ivec2(0))) || any(greaterThanEqual(source, size))) return vec3(0.0);
+    return clamp(texelFetch(Source, LAYER(source), 0).rgb, 0.0, 1.0);
+}
+
+float edgeAt(ivec2 pixel, ivec2 tile) {
+    ivec2 t = pixel - tile + 1;
+    return tileEdges[t.y * EDGE_SPAN + t.x];
+}
+
+void main() {
+    ivec2 size = textureSize(Source, 0).xy;
+    ivec2 tile = ivec2(gl_WorkGroupID.xy) * TILE;
+    ivec2 origin = tile - MAX_HALO;
+    int invocation = int(gl_LocalInvocationIndex);
+    const int invocations = TILE * TILE;
+
+    // PS_Luminance over the tile and the halo the blur and Sobel reach.
+    int halo = _KernelSize + 1;
+    ivec2 lumLow = max(tile - halo, ivec2(0));
+    ivec2 lumExtent = min(tile + TILE + halo, size) - lumLow;
+    for (int i = invocation; i < lumExtent.x * lumExtent.y; i += invocations) {
+        ivec2 pixel = lumLow + ivec2(i % lumExtent.x, i / lumExtent.x);
+        ivec2 t = pixel - origin;
+        tileLuminance[t.y * SPAN + t.x] = luminance(sourceColor(pixel, size));
+    }
+    barrier();
+
+    // PS_HorizontalBlur for every luminance row, on the columns the Sobel needs.
+    ivec2 edgeLow = max(tile - 1, ivec2(0));
+    ivec2 edgeExtent = min(tile + TILE + 1, size) - edgeLow;
+    for (int i = invocation; i < edgeExtent.x * lumExtent.y; i += invocations) {
+        ivec2 pixel = ivec2(edgeLow.x + i % edgeExtent.x, lumLow.y + i / edgeExtent.x);
+        int row = (pixel.y - origin.y) * SPAN;
+
+        vec2 blur = vec2(0.0);
+        for (int x = -_KernelSize; x <= _KernelSize; ++x) {
+            float lum = tileLuminance[row + clamp(pixel.x + x, 0, size.x - 1) - origin.x];
+            blur += lum * _BlurWeights[x + _KernelSize];
+        }
+        tileBlur[(pixel.y - origin.y) * EDGE_SPAN + pixel.x - tile.x + 1] = blur;
+    }
+    barrier();
+
+    // PS_VerticalBlurAndDifference, then PS_EdgeDetect, which without depth
+    // passes the DoG through unchanged.
+    for (int i = invocation; i < edgeExtent.x * edgeExtent.y; i += invocations) {
+        ivec2 pixel = edgeLow + ivec2(i % edgeExtent.x, i / edgeExtent.x);
+        int column = pixel.x - tile.x + 1;
+
+        vec2 blur = vec2(0.0);
+        for (int y = -_KernelSize; y <= _KernelSize; ++y) {
+            vec2 ping = tileBlur[(clamp(pixel.y + y, 0, size.y - 1) - origin.y) * EDGE_SPAN + column];
+            blur += ping * _BlurWeights[y + _KernelSize];
+        }
+
+        float D = blur.x - _Tau * blur.y;
+        ivec2 t = pixel - tile + 1;
+        tileEdges[t.y * EDGE_SPAN + t.x] = (D >= _Threshold) ? 1.0 : 0.0;
+    }
+    barrier();
+
+    // PS_HorizontalSobel on the three rows PS_VerticalSobel combines.
+    ivec2 pos = tile + ivec2(gl_LocalInvocationID.xy);
+    if (pos.x >= size.x || pos.y >= size.y) return;
+
+    int left = max(pos.x - 1, 0);
+    int right = min(pos.x + 1, size.x - 1);
+    int rows[3] = int[3](max(pos.y - 1, 0), pos.y, min(pos.y + 1, size.y - 1));
+    vec2 grad[3];
+    for (int r = 0; r < 3; ++r) {
+        float lum1 = edgeAt(ivec2(left, rows[r]), tile);
+        float lum2 = edgeAt(ivec2(pos.x, rows[r]), tile);
+        float lum3 = edgeAt(ivec2(right, rows[r]), tile);
+        grad[r] = vec2(3.0 * lum1 - 3.0 * lum3, 3.0 * lum1 + 10.0 * lum2 + 3.0 * lum3);
+    }
+
+    float Gx = 3.0 * grad[0].x + 10.0 * grad[1].x + 3.0 * grad[2].x;
+    float Gy = 3.0 * grad[0].y - 3.0 * grad[2].y;
+
+    bool valid = Gx != 0.0 || Gy != 0.0;
+    imageStore(sobelImage, LAYER(pos), valid ? vec4(atan(Gy, Gx), 1.0, 0.0, 0.0) : vec4(0.0));
+}
@@ -0,0 +1,41 @@
+#version 430 core
+#extension GL_ARB_shader_ballot : require
+#extension GL_ARB_gpu_shader_int64 : require
+
+#include "ascii_glyph.glsl"
+
+// The vote of ascii_compute.glsl with subgroup ballots. Each subgroup
+// ballots the two bits of its directions and whether there is one, so three
+// ballots and bitCount give its count per direction, and lane 0 adds the four
+// counts, packed a byte each (at most 64 per cell), with a single atomic:
+// one atomic per subgroup instead of one per voting invocation.
+shared uint packedCounts;
+
+int popcount(uint64_t mask) {
+    uvec2 words = unpackUint2x32(mask);
+    return bitCount(words.x) + bitCount(words.y);
+}
+
+void main() {
+    ivec2 pixelCoords = ivec2(gl_GlobalInvocationID.xy);
+    // Threads past the image edge still take part in the barriers and ballots below.
+    bool inside = pixelCoords.x < _ImageSize.x && pixelCoords.y < _ImageSize.y;
+
+    if (gl_LocalInvocationIndex == 0u) packedCounts = 0u;
+
+    int direction = inside && _Edges ? pixelDirection(pixelCoords) : -1;
+    uint64_t voted = ballotARB(direction >= 0);
+    uint64_t bit0 = ballotARB(direction >= 0 && (direction & 1) != 0);
+    uint64_t bit1 = ballotARB(direction >= 0 && (direction & 2) != 0);
+    uint subgroupCounts = uint(popcount(voted & ~bit0 & ~bit1)) | uint(popcount(bit0 & ~bit1)) << 8u |
+                          uint(popcount(bit1 & ~bit0)) << 16u | uint(popcount(bit0 & bit1)) << 24u;
+
+    barrier();
+    // Every lane is active here, so lane 0 of each subgroup exists.
+    if (gl_SubGroupInvocationARB == 0u && subgroupCounts != 0u) atomicAdd(packedCounts, subgroupCounts);
+    barrier();
+
+    uint total = packedCounts;
+    ivec4 counts = ivec4(total & 0xffu, (total >> 8u) & 0xffu, (total >> 16u) & 0xffu, total >> 24u);
+    writeCell(pixelCoords, inside, winningDirection(counts));
+}
@@ -0,0 +1,92 @@
+// Everything of CS_RenderASCII except the per-cell vote, shared by
+// ascii_compute.glsl (shared-memory vote) and ascii_compute_ballot.glsl
+// (subgroup ballots). Both run one 8x8 work group per cell; built with
+// ASCII_BATCH, every texture is an array and z selects the frame's layer.
+layout(local_size_x = 8, local_size_y = 8) in;
+
+#ifdef ASCII_BATCH
+layout(rgba8, binding = 0) uniform writeonly image2DArray outputImage;
+layout(r16f, binding = 1) uniform writeonly image2DArray cellImage;
+uniform sampler2DArray Sobel;
+uniform sampler2DArray Downscale;
+#define LAYER(p) ivec3(p, gl_WorkGroupID.z)
+#else
+layout(rgba8, binding = 0) uniform writeonly image2D outputImage;
+// One texel per cell, the winning edge direction (-1 for none). Only
+// written, instead of outputImage, when _CellsOnly is set for text output.
+layout(r16f, binding = 1) uniform writeonly image2D cellImage;
+uniform sampler2D Sobel;
+uniform sampler2D Downscale;
+#define LAYER(p) (p)
+#endif
+uniform bool _CellsOnly;
+// The Sobel texture is not bound when _Edges is off, so the size comes from here.
+uniform ivec2 _ImageSize;
+
+#include "ascii_params.glsl"
+
+float glyphBit(uvec2 glyph, ivec2 texel) {
+    int bit = texel.y * 8 + texel.x;
+    uint word = bit < 32 ? glyph.x : glyph.y;
+    return float((word >> uint(bit & 31)) & 1u);
+}
+
+// Edge direction of one pixel from its Sobel angle, -1 for none.
+int pixelDirection(ivec2 pixelCoords) {
+    vec2 sobel = texelFetch(Sobel, LAYER(pixelCoords), 0).rg;
+    float theta = sobel.r;
+    float absTheta = abs(theta) / 3.14159265358979323846;
+
+    int direction = -1;
+    if (sobel.g != 0.0) {
+        if (absTheta < 0.05) direction = 0; // VERTICAL
+        else if (0.9 < absTheta && absTheta <= 1.0) direction = 0;
+        else if (0.45 < absTheta && absTheta < 0.55) direction = 1; // HORIZONTAL
+        else if (0.05 < absTheta && absTheta < 0.45) direction = theta > 0.0 ? 3 : 2; // DIAGONAL 1
+        else if (0.55 < absTheta && absTheta < 0.9) direction = theta > 0.0 ? 2 : 3; // DIAGONAL 2
+    }
+    return direction;
+}
+
+// The direction with the most votes, -1 below _EdgeThreshold; ties go to
+// the lowest direction.
+int winningDirection(ivec4 counts) {
+    int commonEdgeIndex = -1;
+    int maxValue = 0;
+    for (int j = 0; j < 4; j++) {
+        if (counts[j] > maxValue) {
+            commonEdgeIndex = j;
+            maxValue = counts[j];
+        }
+    }
+    if (maxValue < _EdgeThreshold) commonEdgeIndex = -1;
+    return commonEdgeIndex;
+}
+
+// Stores the cell result for text output, or the pixel's glyph colour.
+void writeCell(ivec2 pixelCoords, bool inside, int commonEdgeIndex) {
+    if (_CellsOnly && gl_LocalInvocationIndex == 0u) {
+        imageStore(cellImage, LAYER(ivec2(gl_WorkGroupID.xy)), vec4(float(commonEdgeIndex)));
+    }
+    if (!inside || _CellsOnly) return;
+
+    float ascii = 0.0;
+    ivec2 downscaleID = pixelCoords / 8;
+    vec4 downscaleInfo = texelFetch(Downscale, LAYER(downscaleID), 0);
+
+    if (commonEdgeIndex >= 0 && _Edges) {
+        // ASCII.fx reads row 8 - y % 8 through a repeating sampler, so 8 wraps to 0.
+        ivec2 localUV = ivec2(pixelCoords.x % 8, (8 - pixelCoords.y % 8) % 8);
+        ascii = glyphBit(_EdgesGlyphs[commonEdgeIndex + 1], localUV);
+    } else if (_Fill) {
+        float luminance = clamp(pow(downscaleInfo.w * _Exposure, _Attenuation), 0.0, 1.0);
+        if (_InvertLuminance) luminance = 1.0 - luminance;
+        int glyph = int(max(0.0, floor(luminance * 10.0) - 1.0));
+
+        ascii = glyphBit(_FillGlyphs[glyph], pixelCoords % 8);
+    }
+
+    vec3 color = mix(_BackgroundColor, mix(_ASCIIColor, downscaleInfo.rgb, _BlendWithBase), ascii);
+
+    imageStore(outputImage, LAYER(pixelCoords), vec4(color, 1.0));
+}
@@ -0,0 +1,29 @@
+// The AsciiParams uniform block every program shares, bound to one buffer and
+// only rewritten when a parameter changes. GLParamsBlock in image_processor.h
+// mirrors this std140 layout.
+layout(std140) uniform AsciiParams {
+    vec3 _ASCIIColor;
+    float _BlendWithBase;
+    vec3 _BackgroundColor;
+    float _Exposure;
+    vec2 _Offset;
+    float _Zoom;
+    float _Attenuation;
+    float _Tau;
+    float _Threshold;
+    float _DepthThreshold;
+    float _NormalThreshold;
+    float _DepthCutoff;
+    float _DepthFalloff;
+    float _DepthOffset;
+    int _EdgeThreshold;
+    bool _Edges;
+    bool _Fill;
+    bool _InvertLuminance;
+    bool _UseDepth;
+    bool _UseNormals;
+    // edgesASCII.png and fillASCII.png, one 8x8 glyph per entry: bit y * 8 + x
+    // of (x | y << 32) is texel (x, y) of the glyph.
+    uvec2 _EdgesGlyphs[5];
+    uvec2 _FillGlyphs[10];
+};
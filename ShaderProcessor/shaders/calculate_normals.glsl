@@ -0,0 +1,27 @@
+#version 330 core
+out vec4 FragColor;
+
+// PS_CalculateNormals: view-space normal from linearised depth, depth in w.
+uniform sampler2D Depth;
+
+float depthAt(ivec2 pixel, ivec2 size) {
+    return texelFetch(Depth, clamp(pixel, ivec2(0), size - 1), 0).r;
+}
+
+void main()
+{
+    ivec2 size = textureSize(Depth, 0);
+    ivec2 pos = ivec2(gl_FragCoord.xy);
+    vec2 texelSize = 1.0 / vec2(size);
+
+    vec2 posCenter = (vec2(pos) + 0.5) * texelSize;
+    vec2 posNorth = posCenter - vec2(0.0, texelSize.y);
+    vec2 posEast = posCenter + vec2(texelSize.x, 0.0);
+
+    float centerDepth = depthAt(pos, size);
+    vec3 vertCenter = vec3(posCenter - 0.5, 1.0) * centerDepth;
+    vec3 vertNorth = vec3(posNorth - 0.5, 1.0) * depthAt(pos - ivec2(0, 1), size);
+    vec3 vertEast = vec3(posEast - 0.5, 1.0) * depthAt(pos + ivec2(1, 0), size);
+
+    FragColor = vec4(normalize(cross(vertCenter - vertNorth, vertCenter - vertEast)), centerDepth);
+}
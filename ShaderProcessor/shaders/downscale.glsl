@@ -0,0 +1,44 @@
+#version 330 core
+out vec4 FragColor;
+
+// PS_Downscale into AFX_DownscaleTex: average colour of one 8x8 cell, luminance in w.
+uniform sampler2D Source;
+
+#include "ascii_params.glsl"
+
+float luminance(vec3 rgb) {
+    return max(0.00001, dot(rgb, vec3(0.2127, 0.7152, 0.0722)));
+}
+
+vec2 transformUV(vec2 uv) {
+    vec2 zoomUV = uv * 2.0 - 1.0;
+    zoomUV += vec2(-_Offset.x, _Offset.y) * 2.0;
+    zoomUV *= _Zoom;
+    zoomUV = zoomUV * 0.5 + 0.5;
+    return zoomUV;
+}
+
+vec3 sourceColor(ivec2 pixel, ivec2 size) {
+    ivec2 source = ivec2(floor(transformUV((vec2(pixel) + 0.5) / vec2(size)) * vec2(size)));
+    if (any(lessThan(source, ivec2(0))) || any(greaterThanEqual(source, size))) return vec3(0.0);
+    return clamp(texelFetch(Source, source, 0).rgb, 0.0, 1.0);
+}
+
+void main()
+{
+    ivec2 size = textureSize(Source, 0);
+    ivec2 cell = ivec2(gl_FragCoord.xy) * 8;
+    ivec2 cellEnd = min(cell + 8, size);
+
+    // Partial cells at the right and bottom edges average only the pixels they cover.
+    vec3 sum = vec3(0.0);
+    for (int y = cell.y; y < cellEnd.y; ++y) {
+        for (int x = cell.x; x < cellEnd.x; ++x) {
+            sum += sourceColor(ivec2(x, y), size);
+        }
+    }
+    vec2 extent = vec2(cellEnd - cell);
+    vec3 color = sum / (extent.x * extent.y);
+
+    FragColor = vec4(color, luminance(color));
+}
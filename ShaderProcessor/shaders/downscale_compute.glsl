@@ -0,0 +1,51 @@
+#version 430 core
+layout(local_size_x = 8, local_size_y = 8) in;
+
+// PS_Downscale for a batch of frames in texture array layers: one invocation
+// per cell, z selects the frame. The arithmetic is that of downscale.glsl,
+// so both give the same cells. DOWNSCALE_FORMAT is defined to the image
+// format of the Downscale target at the chosen precision.
+layout(DOWNSCALE_FORMAT, binding = 0) uniform writeonly image2DArray downscaleImage;
+
+uniform sampler2DArray Source;
+
+#include "ascii_params.glsl"
+
+float luminance(vec3 rgb) {
+    return max(0.00001, dot(rgb, vec3(0.2127, 0.7152, 0.0722)));
+}
+
+vec2 transformUV(vec2 uv) {
+    vec2 zoomUV = uv * 2.0 - 1.0;
+    zoomUV += vec2(-_Offset.x, _Offset.y) * 2.0;
+    zoomUV *= _Zoom;
+    zoomUV = zoomUV * 0.5 + 0.5;
+    return zoomUV;
+}
+
+vec3 sourceColor(ivec2 pixel, ivec2 size, int layer) {
+    ivec2 source = ivec2(floor(transformUV((vec2(pixel) + 0.5) / vec2(size)) * vec2(size)));
+    if (any(lessThan(source, ivec2(0))) || any(greaterThanEqual(source, size))) return vec3(0.0);
+    return clamp(texelFetch(Source, ivec3(source, layer), 0).rgb, 0.0, 1.0);
+}
+
+void main() {
+    ivec3 size = textureSize(Source, 0);
+    ivec2 cellCoords = ivec2(gl_GlobalInvocationID.xy);
+    int layer = int(gl_GlobalInvocationID.z);
+    ivec2 cell = cellCoords * 8;
+    if (cell.x >= size.x || cell.y >= size.y) return;
+    ivec2 cellEnd = min(cell + 8, size.xy);
+
+    // Partial cells at the right and bottom edges average only the pixels they cover.
+    vec3 sum = vec3(0.0);
+    for (int y = cell.y; y < cellEnd.y; ++y) {
+        for (int x = cell.x; x < cellEnd.x; ++x) {
+            sum += sourceColor(ivec2(x, y), size.xy, layer);
+        }
+    }
+    vec2 extent = vec2(cellEnd - cell);
+    vec3 color = sum / (extent.x * extent.y);
+
+    imageStore(downscaleImage, ivec3(cellCoords, layer), vec4(color, luminance(color)));
+}
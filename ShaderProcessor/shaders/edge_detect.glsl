@@ -0,0 +1,33 @@
+#version 330 core
+out float FragColor;
+
+// PS_EdgeDetect into AFX_AsciiEdgesTex: DoG edges, toggled by depth and normal discontinuities.
+uniform sampler2D Normals;
+uniform sampler2D DoG;
+
+#include "ascii_params.glsl"
+
+void main()
+{
+    ivec2 size = textureSize(DoG, 0);
+    ivec2 pos = ivec2(gl_FragCoord.xy);
+
+    float edge = 0.0;
+    if (_UseDepth || _UseNormals) {
+        vec4 c = texelFetch(Normals, pos, 0);
+        float depthSum = 0.0;
+        vec3 normalSum = vec3(0.0);
+        for (int y = -1; y <= 1; ++y) {
+            for (int x = -1; x <= 1; ++x) {
+                vec4 n = texelFetch(Normals, clamp(pos + ivec2(x, y), ivec2(0), size - 1), 0);
+                depthSum += abs(n.w - c.w);
+                normalSum += abs(n.rgb - c.rgb);
+            }
+        }
+        if (_UseDepth && depthSum > _DepthThreshold) edge = 1.0;
+        if (_UseNormals && dot(normalSum, vec3(1.0)) > _NormalThreshold) edge = 1.0;
+    }
+
+    float D = texelFetch(DoG, pos, 0).r;
+    FragColor = clamp(abs(D - edge), 0.0, 1.0);
+}
@@ -0,0 +1,10 @@
+#version 330 core
+out vec4 FragColor;
+
+// PS_EndPass: copies the ASCII render into the 8-bit readback target.
+uniform sampler2D ASCII;
+
+void main()
+{
+    FragColor = texelFetch(ASCII, ivec2(gl_FragCoord.xy), 0);
+}
@@ -0,0 +1,22 @@
+#version 330 core
+out vec2 FragColor;
+
+// PS_HorizontalBlur: both DoG blurs along x, written as (narrow, wide) into AFX_AsciiPingTex.
+uniform sampler2D Luminance;
+
+uniform int _KernelSize;
+uniform vec2 _BlurWeights[21];
+
+void main()
+{
+    ivec2 size = textureSize(Luminance, 0);
+    ivec2 pos = ivec2(gl_FragCoord.xy);
+
+    vec2 blur = vec2(0.0);
+    for (int x = -_KernelSize; x <= _KernelSize; ++x) {
+        float lum = texelFetch(Luminance, ivec2(clamp(pos.x + x, 0, size.x - 1), pos.y), 0).r;
+        blur += lum * _BlurWeights[x + _KernelSize];
+    }
+
+    FragColor = blur;
+}
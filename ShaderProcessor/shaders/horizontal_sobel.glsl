@@ -0,0 +1,21 @@
+#version 330 core
+out vec2 FragColor;
+
+// PS_HorizontalSobel into AFX_AsciiPingTex.
+uniform sampler2D Edges;
+
+void main()
+{
+    ivec2 size = textureSize(Edges, 0);
+    ivec2 pos = ivec2(gl_FragCoord.xy);
+
+    float lum1 = texelFetch(Edges, ivec2(max(pos.x - 1, 0), pos.y), 0).r;
+    float lum2 = texelFetch(Edges, pos, 0).r;
+    float lum3 = texelFetch(Edges, ivec2(min(pos.x + 1, size.x - 1), pos.y), 0).r;
+
+    // ASCII.fx has "3 + lum1" here; the smoothing half of the Sobel kernel is 3 * lum1.
+    float Gx = 3.0 * lum1 - 3.0 * lum3;
+    float Gy = 3.0 * lum1 + 10.0 * lum2 + 3.0 * lum3;
+
+    FragColor = vec2(Gx, Gy);
+}
@@ -0,0 +1,31 @@
+#version 330 core
+out float FragColor;
+
+// PS_Luminance into AFX_LuminanceAsciiTex.
+uniform sampler2D Source;
+
+#include "ascii_params.glsl"
+
+float luminance(vec3 rgb) {
+    return max(0.00001, dot(rgb, vec3(0.2127, 0.7152, 0.0722)));
+}
+
+vec2 transformUV(vec2 uv) {
+    vec2 zoomUV = uv * 2.0 - 1.0;
+    zoomUV += vec2(-_Offset.x, _Offset.y) * 2.0;
+    zoomUV *= _Zoom;
+    zoomUV = zoomUV * 0.5 + 0.5;
+    return zoomUV;
+}
+
+// Nearest source texel under the zoom/offset transform, black outside the image.
+vec3 sourceColor(ivec2 pixel, ivec2 size) {
+    ivec2 source = ivec2(floor(transformUV((vec2(pixel) + 0.5) / vec2(size)) * vec2(size)));
+    if (any(lessThan(source, ivec2(0))) || any(greaterThanEqual(source, size))) return vec3(0.0);
+    return clamp(texelFetch(Source, source, 0).rgb, 0.0, 1.0);
+}
+
+void main()
+{
+    FragColor = luminance(sourceColor(ivec2(gl_FragCoord.xy), textureSize(Source, 0)));
+}
@@ -0,0 +1,25 @@
+#version 330 core
+out float FragColor;
+
+// PS_VerticalBlurAndDifference: finishes both blurs along y and thresholds their difference.
+uniform sampler2D AsciiPing;
+
+uniform int _KernelSize;
+uniform vec2 _BlurWeights[21];
+
+#include "ascii_params.glsl"
+
+void main()
+{
+    ivec2 size = textureSize(AsciiPing, 0);
+    ivec2 pos = ivec2(gl_FragCoord.xy);
+
+    vec2 blur = vec2(0.0);
+    for (int y = -_KernelSize; y <= _KernelSize; ++y) {
+        vec2 ping = texelFetch(AsciiPing, ivec2(pos.x, clamp(pos.y + y, 0, size.y - 1)), 0).rg;
+        blur += ping * _BlurWeights[y + _KernelSize];
+    }
+
+    float D = blur.x - _Tau * blur.y;
+    FragColor = (D >= _Threshold) ? 1.0 : 0.0;
+}
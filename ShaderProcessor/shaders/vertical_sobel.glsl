@@ -0,0 +1,30 @@
+#version 330 core
+out vec2 FragColor;
+
+// PS_VerticalSobel into AFX_AsciiSobelTex: gradient angle in r, 1 in g where the gradient exists.
+uniform sampler2D AsciiPing;
+uniform sampler2D Depth;
+
+#include "ascii_params.glsl"
+
+void main()
+{
+    ivec2 size = textureSize(AsciiPing, 0);
+    ivec2 pos = ivec2(gl_FragCoord.xy);
+
+    vec2 grad1 = texelFetch(AsciiPing, ivec2(pos.x, max(pos.y - 1, 0)), 0).rg;
+    vec2 grad2 = texelFetch(AsciiPing, pos, 0).rg;
+    vec2 grad3 = texelFetch(AsciiPing, ivec2(pos.x, min(pos.y + 1, size.y - 1)), 0).rg;
+
+    float Gx = 3.0 * grad1.x + 10.0 * grad2.x + 3.0 * grad3.x;
+    float Gy = 3.0 * grad1.y - 3.0 * grad3.y;
+
+    // normalize() of a zero gradient is NaN in ASCII.fx; test for it directly
+    // since GLSL leaves that result undefined.
+    bool valid = Gx != 0.0 || Gy != 0.0;
+    if (valid && _DepthCutoff > 0.0) {
+        valid = texelFetch(Depth, pos, 0).r * 1000.0 <= _DepthCutoff;
+    }
+
+    FragColor = valid ? vec2(atan(Gy, Gx), 1.0) : vec2(0.0);
+}
@@ -0,0 +1,69 @@
+#include "cell_text.h"
+#include "cpu_stages.h"
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+// The glyphs of edgesASCII.png (vertical, horizontal, then the diagonals as
+// drawn once flipped) and the ten fillASCII.png glyphs from dark to bright.
+static const char EDGE_CHARS[4] = {'|', '-', '\\', '/'};
+static const char FILL_CHARS[10] = {' ', '.', ':', '-', '=', '+', '*', '#', '%', '@'};
+
+static char cellChar(int commonEdgeIndex, float cellLuminance, const AsciiParams& params) {
+    if (commonEdgeIndex >= 0 && params.edges) return EDGE_CHARS[commonEdgeIndex];
+    if (params.fill) return FILL_CHARS[std::min(asciiFillGlyph(cellLuminance, params), 9)];
+    return ' ';
+}
+
+static int colourByte(float value) {
+    return static_cast<int>(asciiSaturate(value) * 255.0f + 0.5f);
+}
+
+bool writeCellText(const char* path, OutputFormat format, int cellsX, int cellsY, const int* cellEdges,
+                   const float* downscale, const AsciiParams& params) {
+    // Each row is built in memory and written with one call.
+    std::string line;
+    line.reserve(static_cast<size_t>(cellsX) * (format == OutputFormat::ANSI ? 20 : 1) + 8);
+
+    std::cout << "Attempting to write output text to: " << path << std::endl;
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        std::cerr << "Failed to write output text: " << path << std::endl;
+        return false;
+    }
+
+    bool ok = true;
+    for (int cy = 0; cy < cellsY && ok; ++cy) {
+        line.clear();
+        int lastColour = -1;
+        for (int cx = 0; cx < cellsX; ++cx) {
+            size_t cell = static_cast<size_t>(cy) * cellsX + cx;
+            const float* info = &downscale[cell * 4];
+            char c = cellChar(cellEdges[cell], info[3], params);
+
+            // Escapes only where the colour changes, and never for blanks
+            if (format == OutputFormat::ANSI && c != ' ') {
+                int colour = (colourByte(info[0]) << 16) | (colourByte(info[1]) << 8) | colourByte(info[2]);
+                if (colour != lastColour) {
+                    char escape[24];
+                    int length = snprintf(escape, sizeof(escape), "\x1b[38;2;%d;%d;%dm",
+                                          colour >> 16, (colour >> 8) & 0xFF, colour & 0xFF);
+                    line.append(escape, length);
+                    lastColour = colour;
+                }
+            }
+            line += c;
+        }
+        if (format == OutputFormat::ANSI && lastColour >= 0) line += "\x1b[0m";
+        line += '\n';
+        ok = fwrite(line.data(), 1, line.size(), file) == line.size();
+    }
+
+    if (fclose(file) != 0) ok = false;
+    if (!ok) {
+        std::cerr << "Failed to write output text: " << path << std::endl;
+        return false;
+    }
+    std::cout << "Output text saved successfully: " << path << std::endl;
+    return true;
+}
@@ -0,0 +1,193 @@
+#include "cpu_kernels.h"
+#include "cpu_stages.h"
+#include <cstring>
+
+void storeCellAverage(float* cell, unsigned int sumR, unsigned int sumG, unsigned int sumB, int count) {
+    float scale = 1.0f / (count * 255.0f);
+    cell[0] = sumR * scale;
+    cell[1] = sumG * scale;
+    cell[2] = sumB * scale;
+    cell[3] = asciiLuminance(cell[0], cell[1], cell[2]);
+}
+
+void lumaDownscaleScalar(const LumaDownscaleArgs& args, int cellBegin, int cellEnd) {
+    for (int cx = cellBegin; cx < cellEnd; ++cx) {
+        int x0 = cx * 8;
+        int x1 = std::min(x0 + 8, args.width);
+        unsigned int sum[3] = {0, 0, 0};
+        for (int y = 0; y < args.rows; ++y) {
+            const unsigned char* src = args.pixels + y * args.pixelStride + static_cast<size_t>(x0) * args.channels;
+            float* lum = args.luminance + y * args.luminanceStride;
+            for (int x = x0; x < x1; ++x, src += args.channels) {
+                unsigned int r = src[0];
+                unsigned int g = args.channels < 3 ? src[0] : src[1];
+                unsigned int b = args.channels < 3 ? src[0] : src[2];
+                sum[0] += r;
+                sum[1] += g;
+                sum[2] += b;
+                lum[x] = std::max(LUMA_MIN, r * LUMA_R + g * LUMA_G + b * LUMA_B);
+            }
+        }
+        storeCellAverage(args.downscale + cx * 4, sum[0], sum[1], sum[2], (x1 - x0) * args.rows);
+    }
+}
+
+void blurSpanScalar(const float* luminance, int width, const float* taps, int radius, float* ping, int x0, int x1) {
+    for (int x = x0; x < x1; ++x) {
+        float blur1 = 0.0f, blur2 = 0.0f;
+        for (int i = -radius; i <= radius; ++i) {
+            float lum = luminance[std::min(std::max(x + i, 0), width - 1)];
+            blur1 += lum * taps[(i + radius) * 2];
+            blur2 += lum * taps[(i + radius) * 2 + 1];
+        }
+        ping[x * 2] = blur1;
+        ping[x * 2 + 1] = blur2;
+    }
+}
+
+void blurRowScalar(const float* luminance, int width, const float* taps, int radius, float* ping) {
+    blurSpanScalar(luminance, width, taps, radius, ping, 0, width);
+}
+
+void blurDifferenceSpanScalar(const float* const* pingRows, const float* taps, int radius,
+                              float tau, float threshold, float* dog, int x0, int x1) {
+    for (int x = x0; x < x1; ++x) {
+        float blur1 = 0.0f, blur2 = 0.0f;
+        for (int i = 0; i <= 2 * radius; ++i) {
+            const float* ping = pingRows[i] + x * 2;
+            blur1 += ping[0] * taps[i * 2];
+            blur2 += ping[1] * taps[i * 2 + 1];
+        }
+        dog[x] = (blur1 - tau * blur2) >= threshold ? 1.0f : 0.0f;
+    }
+}
+
+void blurDifferenceRowScalar(const float* const* pingRows, int width, const float* taps, int radius,
+                             float tau, float threshold, float* dog) {
+    blurDifferenceSpanScalar(pingRows, taps, radius, tau, threshold, dog, 0, width);
+}
+
+void expandGlyphScalar(uint64_t glyph, const unsigned char* foreground, const unsigned char* background,
+                       int columns, int rows, unsigned char* out, size_t outStride) {
+    for (int y = 0; y < rows; ++y, out += outStride) {
+        for (int x = 0; x < columns; ++x) {
+            memcpy(out + x * 3, glyphBit(glyph, x, y) ? foreground : background, 3);
+        }
+    }
+}
+
+void lumaDownscaleU8Scalar(const LumaDownscaleArgs& args, int cellBegin, int cellEnd) {
+    for (int cx = cellBegin; cx < cellEnd; ++cx) {
+        int x0 = cx * 8;
+        int x1 = std::min(x0 + 8, args.width);
+        unsigned int sum[3] = {0, 0, 0};
+        for (int y = 0; y < args.rows; ++y) {
+            const unsigned char* src = args.pixels + y * args.pixelStride + static_cast<size_t>(x0) * args.channels;
+            unsigned char* lum = args.luminance8 + y * args.luminanceStride;
+            for (int x = x0; x < x1; ++x, src += args.channels) {
+                unsigned int r = src[0];
+                unsigned int g = args.channels < 3 ? src[0] : src[1];
+                unsigned int b = args.channels < 3 ? src[0] : src[2];
+                sum[0] += r;
+                sum[1] += g;
+                sum[2] += b;
+                lum[x] = static_cast<unsigned char>((r * LUMA_R8 + g * LUMA_G8 + b * LUMA_B8 + 128) >> 8);
+            }
+        }
+        storeCellAverage(args.downscale + cx * 4, sum[0], sum[1], sum[2], (x1 - x0) * args.rows);
+    }
+}
+
+void blurSpanU16Scalar(const unsigned char* luminance, int width, const uint16_t* taps, int radius, uint16_t* ping,
+                       int x0, int x1) {
+    for (int x = x0; x < x1; ++x) {
+        unsigned int blur1 = 0, blur2 = 0;
+        for (int i = -radius; i <= radius; ++i) {
+            unsigned int lum = luminance[std::min(std::max(x + i, 0), width - 1)] << 8;
+            blur1 += (lum * taps[(i + radius) * 2]) >> 16;
+            blur2 += (lum * taps[(i + radius) * 2 + 1]) >> 16;
+        }
+        ping[x * 2] = static_cast<uint16_t>(blur1);
+        ping[x * 2 + 1] = static_cast<uint16_t>(blur2);
+    }
+}
+
+void blurRowU16Scalar(const unsigned char* luminance, int width, const uint16_t* taps, int radius, uint16_t* ping) {
+    blurSpanU16Scalar(luminance, width, taps, radius, ping, 0, width);
+}
+
+void blurDifferenceSpanU16Scalar(const uint16_t* const* pingRows, const uint16_t* taps, int radius, int tauQ8,
+                                 int thresholdQ, unsigned char* dog, int x0, int x1) {
+    for (int x = x0; x < x1; ++x) {
+        unsigned int blur1 = 0, blur2 = 0;
+        for (int i = 0; i <= 2 * radius; ++i) {
+            const uint16_t* ping = pingRows[i] + x * 2;
+            blur1 += (ping[0] * static_cast<unsigned int>(taps[i * 2])) >> 16;
+            blur2 += (ping[1] * static_cast<unsigned int>(taps[i * 2 + 1])) >> 16;
+        }
+        int difference = 256 * static_cast<int>(blur1 >> 1) - tauQ8 * static_cast<int>(blur2 >> 1);
+        dog[x] = difference >= thresholdQ ? 1 : 0;
+    }
+}
+
+void blurDifferenceRowU16Scalar(const uint16_t* const* pingRows, int width, const uint16_t* taps, int radius,
+                                int tauQ8, int thresholdQ, unsigned char* dog) {
+    blurDifferenceSpanU16Scalar(pingRows, taps, radius, tauQ8, thresholdQ, dog, 0, width);
+}
+
+static const CpuKernels scalarKernels = {SimdLevel::Scalar, "scalar", lumaDownscaleScalar, blurRowScalar,
+                                         blurDifferenceRowScalar, expandGlyphScalar,
+                                         lumaDownscaleU8Scalar, blurRowU16Scalar, blurDifferenceRowU16Scalar};
+#ifdef ASCII_X86_KERNELS
+static const CpuKernels sse41Kernels = {SimdLevel::SSE41, "sse4.1", lumaDownscaleSSE41, blurRowSSE41,
+                                        blurDifferenceRowSSE41, expandGlyphSSE41,
+                                        lumaDownscaleU8SSE41, blurRowU16SSE41, blurDifferenceRowU16SSE41};
+static const CpuKernels avx2Kernels = {SimdLevel::AVX2, "avx2", lumaDownscaleAVX2, blurRowAVX2,
+                                       blurDifferenceRowAVX2, expandGlyphSSE41,
+                                       lumaDownscaleU8SSE41, blurRowU16AVX2, blurDifferenceRowU16AVX2};
+static const CpuKernels avx512Kernels = {SimdLevel::AVX512, "avx512", lumaDownscaleAVX512, blurRowAVX512,
+                                         blurDifferenceRowAVX512, expandGlyphSSE41,
+                                         lumaDownscaleU8SSE41, blurRowU16AVX2, blurDifferenceRowU16AVX2};
+#endif
+
+static SimdLevel detectSimdLevel() {
+#ifdef ASCII_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) return SimdLevel::AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse4.1")) return SimdLevel::SSE41;
+#endif
+    return SimdLevel::Scalar;
+}
+
+static const CpuKernels* kernelsForLevel(SimdLevel level) {
+#ifdef ASCII_X86_KERNELS
+    switch (level) {
+        case SimdLevel::AVX512: return &avx512Kernels;
+        case SimdLevel::AVX2: return &avx2Kernels;
+        case SimdLevel::SSE41: return &sse41Kernels;
+        case SimdLevel::Scalar: break;
+    }
+#endif
+    return &scalarKernels;
+}
+
+static const CpuKernels* selectedKernels = nullptr;
+
+const CpuKernels& cpuKernels() {
+    if (!selectedKernels) selectedKernels = kernelsForLevel(detectSimdLevel());
+    return *selectedKernels;
+}
+
+bool setCpuKernelLevel(const char* name) {
+    SimdLevel requested;
+    if (strcmp(name, "scalar") == 0) requested = SimdLevel::Scalar;
+    else if (strcmp(name, "sse4.1") == 0) requested = SimdLevel::SSE41;
+    else if (strcmp(name, "avx2") == 0) requested = SimdLevel::AVX2;
+    else if (strcmp(name, "avx512") == 0) requested = SimdLevel::AVX512;
+    else return false;
+
+    SimdLevel best = detectSimdLevel();
+    selectedKernels = kernelsForLevel(static_cast<int>(requested) < static_cast<int>(best) ? requested : best);
+    return true;
+}
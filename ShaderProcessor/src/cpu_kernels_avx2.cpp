@@ -0,0 +1,127 @@
+#include "cpu_kernels.h"
+#include "cpu_kernels_x86.h"
+#include <algorithm>
+
+static inline __m256 luminance8(__m128i r, __m128i g, __m128i b) {
+    __m256 fr = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(r));
+    __m256 fg = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(g));
+    __m256 fb = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(b));
+    __m256 lum = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(fr, _mm256_set1_ps(LUMA_R)), _mm256_mul_ps(fg, _mm256_set1_ps(LUMA_G))),
+                               _mm256_mul_ps(fb, _mm256_set1_ps(LUMA_B)));
+    return _mm256_max_ps(lum, _mm256_set1_ps(LUMA_MIN));
+}
+
+void lumaDownscaleAVX2(const LumaDownscaleArgs& args, int cellBegin, int cellEnd) {
+    if (args.channels < 3) {
+        lumaDownscaleScalar(args, cellBegin, cellEnd);
+        return;
+    }
+
+    const __m128i zero = _mm_setzero_si128();
+    int fullCells = std::min(cellEnd, args.width / 8);
+    int cx = cellBegin;
+    for (; cx < fullCells; ++cx) {
+        __m128i sumR = zero, sumG = zero, sumB = zero;
+        for (int y = 0; y < args.rows; ++y) {
+            __m128i r, g, b;
+            deinterleave8(args.pixels + y * args.pixelStride + static_cast<size_t>(cx) * 8 * args.channels, args.channels, r, g, b);
+            sumR = _mm_add_epi64(sumR, _mm_sad_epu8(r, zero));
+            sumG = _mm_add_epi64(sumG, _mm_sad_epu8(g, zero));
+            sumB = _mm_add_epi64(sumB, _mm_sad_epu8(b, zero));
+            _mm256_storeu_ps(args.luminance + y * args.luminanceStride + cx * 8, luminance8(r, g, b));
+        }
+        storeCellAverage(args.downscale + cx * 4, _mm_cvtsi128_si32(sumR), _mm_cvtsi128_si32(sumG),
+                         _mm_cvtsi128_si32(sumB), 8 * args.rows);
+    }
+    if (cx < cellEnd) lumaDownscaleScalar(args, cx, cellEnd);
+}
+
+void blurRowAVX2(const float* luminance, int width, const float* taps, int radius, float* ping) {
+    int x0 = std::min(radius, width);
+    int x1 = std::max(x0, width - radius);
+    blurSpanScalar(luminance, width, taps, radius, ping, 0, x0);
+    int x = x0;
+    for (; x + 8 <= x1; x += 8) {
+        __m256 blur1 = _mm256_setzero_ps(), blur2 = _mm256_setzero_ps();
+        for (int i = -radius; i <= radius; ++i) {
+            __m256 lum = _mm256_loadu_ps(luminance + x + i);
+            blur1 = _mm256_add_ps(blur1, _mm256_mul_ps(lum, _mm256_set1_ps(taps[(i + radius) * 2])));
+            blur2 = _mm256_add_ps(blur2, _mm256_mul_ps(lum, _mm256_set1_ps(taps[(i + radius) * 2 + 1])));
+        }
+        __m256 lo = _mm256_unpacklo_ps(blur1, blur2);
+        __m256 hi = _mm256_unpackhi_ps(blur1, blur2);
+        _mm256_storeu_ps(ping + x * 2, _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps(ping + x * 2 + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+    }
+    blurSpanScalar(luminance, width, taps, radius, ping, x, width);
+}
+
+void blurDifferenceRowAVX2(const float* const* pingRows, int width, const float* taps, int radius,
+                           float tau, float threshold, float* dog) {
+    const __m256 tauV = _mm256_set1_ps(tau);
+    const __m256 thresholdV = _mm256_set1_ps(threshold);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+        for (int i = 0; i <= 2 * radius; ++i) {
+            __m256 weights = _mm256_castpd_ps(_mm256_broadcastsd_pd(_mm_castsi128_pd(tapPair(taps + i * 2))));
+            const float* row = pingRows[i] + x * 2;
+            acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(row), weights));
+            acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(row + 8), weights));
+        }
+        // The in-lane shuffles leave pixels ordered 0 1 4 5 2 3 6 7; one 64-bit permute restores them.
+        __m256 blur1 = _mm256_shuffle_ps(acc0, acc1, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 blur2 = _mm256_shuffle_ps(acc0, acc1, _MM_SHUFFLE(3, 1, 3, 1));
+        blur1 = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(blur1), _MM_SHUFFLE(3, 1, 2, 0)));
+        blur2 = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(blur2), _MM_SHUFFLE(3, 1, 2, 0)));
+        __m256 difference = _mm256_sub_ps(blur1, _mm256_mul_ps(tauV, blur2));
+        _mm256_storeu_ps(dog + x, _mm256_and_ps(_mm256_cmp_ps(difference, thresholdV, _CMP_GE_OQ), one));
+    }
+    blurDifferenceSpanScalar(pingRows, taps, radius, tau, threshold, dog, x, width);
+}
+
+void blurRowU16AVX2(const unsigned char* luminance, int width, const uint16_t* taps, int radius, uint16_t* ping) {
+    int x0 = std::min(radius, width);
+    int x1 = std::max(x0, width - radius);
+    blurSpanU16Scalar(luminance, width, taps, radius, ping, 0, x0);
+    int x = x0;
+    for (; x + 16 <= x1; x += 16) {
+        __m256i blur1 = _mm256_setzero_si256(), blur2 = _mm256_setzero_si256();
+        for (int i = -radius; i <= radius; ++i) {
+            __m256i lum = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(luminance + x + i)));
+            lum = _mm256_slli_epi16(lum, 8);
+            blur1 = _mm256_add_epi16(blur1, _mm256_mulhi_epu16(lum, _mm256_set1_epi16(taps[(i + radius) * 2])));
+            blur2 = _mm256_add_epi16(blur2, _mm256_mulhi_epu16(lum, _mm256_set1_epi16(taps[(i + radius) * 2 + 1])));
+        }
+        __m256i lo = _mm256_unpacklo_epi16(blur1, blur2);
+        __m256i hi = _mm256_unpackhi_epi16(blur1, blur2);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(ping + x * 2), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(ping + x * 2 + 16), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    blurSpanU16Scalar(luminance, width, taps, radius, ping, x, width);
+}
+
+void blurDifferenceRowU16AVX2(const uint16_t* const* pingRows, int width, const uint16_t* taps, int radius,
+                              int tauQ8, int thresholdQ, unsigned char* dog) {
+    const __m256i scale = _mm256_set1_epi32(static_cast<int>(256u | (static_cast<unsigned int>(-tauQ8) << 16)));
+    const __m256i threshold = _mm256_set1_epi32(thresholdQ - 1);
+    const __m128i one = _mm_set1_epi8(1);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256();
+        for (int i = 0; i <= 2 * radius; ++i) {
+            __m256i weights = _mm256_set1_epi32(static_cast<int>(taps[i * 2] | (static_cast<unsigned int>(taps[i * 2 + 1]) << 16)));
+            const uint16_t* row = pingRows[i] + x * 2;
+            acc0 = _mm256_add_epi16(acc0, _mm256_mulhi_epu16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(row)), weights));
+            acc1 = _mm256_add_epi16(acc1, _mm256_mulhi_epu16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + 16)), weights));
+        }
+        __m256i edge0 = _mm256_cmpgt_epi32(_mm256_madd_epi16(_mm256_srli_epi16(acc0, 1), scale), threshold);
+        __m256i edge1 = _mm256_cmpgt_epi32(_mm256_madd_epi16(_mm256_srli_epi16(acc1, 1), scale), threshold);
+        // In-lane packing leaves pixels ordered 0-3 8-11 4-7 12-15; one 64-bit permute restores them.
+        __m256i edges = _mm256_permute4x64_epi64(_mm256_packs_epi32(edge0, edge1), _MM_SHUFFLE(3, 1, 2, 0));
+        __m128i bytes = _mm_packs_epi16(_mm256_castsi256_si128(edges), _mm256_extracti128_si256(edges, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dog + x), _mm_and_si128(bytes, one));
+    }
+    blurDifferenceSpanU16Scalar(pingRows, taps, radius, tauQ8, thresholdQ, dog, x, width);
+}
@@ -0,0 +1,98 @@
+#include "cpu_kernels.h"
+#include "cpu_kernels_x86.h"
+#include <algorithm>
+
+static inline __m512 luminance16(__m128i r, __m128i g, __m128i b) {
+    __m512 fr = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(r));
+    __m512 fg = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(g));
+    __m512 fb = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(b));
+    __m512 lum = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(fr, _mm512_set1_ps(LUMA_R)), _mm512_mul_ps(fg, _mm512_set1_ps(LUMA_G))),
+                               _mm512_mul_ps(fb, _mm512_set1_ps(LUMA_B)));
+    return _mm512_max_ps(lum, _mm512_set1_ps(LUMA_MIN));
+}
+
+void lumaDownscaleAVX512(const LumaDownscaleArgs& args, int cellBegin, int cellEnd) {
+    if (args.channels < 3) {
+        lumaDownscaleScalar(args, cellBegin, cellEnd);
+        return;
+    }
+
+    // Two cells per iteration: one 16-lane vector covers a row of both, and
+    // _mm_sad_epu8 sums each cell's 8 bytes into its own 64-bit lane.
+    const __m128i zero = _mm_setzero_si128();
+    const size_t cellBytes = 8 * static_cast<size_t>(args.channels);
+    int fullCells = std::min(cellEnd, args.width / 8);
+    int cx = cellBegin;
+    for (; cx + 1 < fullCells; cx += 2) {
+        __m128i sumR = zero, sumG = zero, sumB = zero;
+        for (int y = 0; y < args.rows; ++y) {
+            const unsigned char* src = args.pixels + y * args.pixelStride + cx * cellBytes;
+            __m128i r0, g0, b0, r1, g1, b1;
+            deinterleave8(src, args.channels, r0, g0, b0);
+            deinterleave8(src + cellBytes, args.channels, r1, g1, b1);
+            __m128i r = _mm_unpacklo_epi64(r0, r1);
+            __m128i g = _mm_unpacklo_epi64(g0, g1);
+            __m128i b = _mm_unpacklo_epi64(b0, b1);
+            sumR = _mm_add_epi64(sumR, _mm_sad_epu8(r, zero));
+            sumG = _mm_add_epi64(sumG, _mm_sad_epu8(g, zero));
+            sumB = _mm_add_epi64(sumB, _mm_sad_epu8(b, zero));
+            _mm512_storeu_ps(args.luminance + y * args.luminanceStride + cx * 8, luminance16(r, g, b));
+        }
+        storeCellAverage(args.downscale + cx * 4, _mm_cvtsi128_si32(sumR), _mm_cvtsi128_si32(sumG),
+                         _mm_cvtsi128_si32(sumB), 8 * args.rows);
+        storeCellAverage(args.downscale + (cx + 1) * 4, _mm_extract_epi32(sumR, 2), _mm_extract_epi32(sumG, 2),
+                         _mm_extract_epi32(sumB, 2), 8 * args.rows);
+    }
+    // An odd full cell and the partial edge cell are cheaper in the narrower kernels.
+    if (cx < fullCells) {
+        lumaDownscaleAVX2(args, cx, cx + 1);
+        ++cx;
+    }
+    if (cx < cellEnd) lumaDownscaleScalar(args, cx, cellEnd);
+}
+
+void blurRowAVX512(const float* luminance, int width, const float* taps, int radius, float* ping) {
+    const __m512i firstHalf = _mm512_setr_epi32(0, 1, 2, 3, 16, 17, 18, 19, 4, 5, 6, 7, 20, 21, 22, 23);
+    const __m512i secondHalf = _mm512_setr_epi32(8, 9, 10, 11, 24, 25, 26, 27, 12, 13, 14, 15, 28, 29, 30, 31);
+    int x0 = std::min(radius, width);
+    int x1 = std::max(x0, width - radius);
+    blurSpanScalar(luminance, width, taps, radius, ping, 0, x0);
+    int x = x0;
+    for (; x + 16 <= x1; x += 16) {
+        __m512 blur1 = _mm512_setzero_ps(), blur2 = _mm512_setzero_ps();
+        for (int i = -radius; i <= radius; ++i) {
+            __m512 lum = _mm512_loadu_ps(luminance + x + i);
+            blur1 = _mm512_add_ps(blur1, _mm512_mul_ps(lum, _mm512_set1_ps(taps[(i + radius) * 2])));
+            blur2 = _mm512_add_ps(blur2, _mm512_mul_ps(lum, _mm512_set1_ps(taps[(i + radius) * 2 + 1])));
+        }
+        __m512 lo = _mm512_unpacklo_ps(blur1, blur2);
+        __m512 hi = _mm512_unpackhi_ps(blur1, blur2);
+        _mm512_storeu_ps(ping + x * 2, _mm512_permutex2var_ps(lo, firstHalf, hi));
+        _mm512_storeu_ps(ping + x * 2 + 16, _mm512_permutex2var_ps(lo, secondHalf, hi));
+    }
+    blurSpanScalar(luminance, width, taps, radius, ping, x, width);
+}
+
+void blurDifferenceRowAVX512(const float* const* pingRows, int width, const float* taps, int radius,
+                             float tau, float threshold, float* dog) {
+    const __m512i evenLanes = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+    const __m512i oddLanes = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+    const __m512 tauV = _mm512_set1_ps(tau);
+    const __m512 thresholdV = _mm512_set1_ps(threshold);
+    const __m512 one = _mm512_set1_ps(1.0f);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m512 acc0 = _mm512_setzero_ps(), acc1 = _mm512_setzero_ps();
+        for (int i = 0; i <= 2 * radius; ++i) {
+            __m512 weights = _mm512_castpd_ps(_mm512_broadcastsd_pd(_mm_castsi128_pd(tapPair(taps + i * 2))));
+            const float* row = pingRows[i] + x * 2;
+            acc0 = _mm512_add_ps(acc0, _mm512_mul_ps(_mm512_loadu_ps(row), weights));
+            acc1 = _mm512_add_ps(acc1, _mm512_mul_ps(_mm512_loadu_ps(row + 16), weights));
+        }
+        __m512 blur1 = _mm512_permutex2var_ps(acc0, evenLanes, acc1);
+        __m512 blur2 = _mm512_permutex2var_ps(acc0, oddLanes, acc1);
+        __m512 difference = _mm512_sub_ps(blur1, _mm512_mul_ps(tauV, blur2));
+        _mm512_storeu_ps(dog + x, _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(difference, thresholdV, _CMP_GE_OQ), one));
+    }
+    blurDifferenceSpanScalar(pingRows, taps, radius, tau, threshold, dog, x, width);
+}
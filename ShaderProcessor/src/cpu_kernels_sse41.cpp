@@ -0,0 +1,185 @@
+#include "cpu_kernels.h"
+#include "cpu_kernels_x86.h"
+#include <algorithm>
+
+static inline __m128 luminance4(__m128i r, __m128i g, __m128i b) {
+    __m128 fr = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(r));
+    __m128 fg = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(g));
+    __m128 fb = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(b));
+    __m128 lum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(fr, _mm_set1_ps(LUMA_R)), _mm_mul_ps(fg, _mm_set1_ps(LUMA_G))),
+                            _mm_mul_ps(fb, _mm_set1_ps(LUMA_B)));
+    return _mm_max_ps(lum, _mm_set1_ps(LUMA_MIN));
+}
+
+void lumaDownscaleSSE41(const LumaDownscaleArgs& args, int cellBegin, int cellEnd) {
+    if (args.channels < 3) {
+        lumaDownscaleScalar(args, cellBegin, cellEnd);
+        return;
+    }
+
+    const __m128i zero = _mm_setzero_si128();
+    int fullCells = std::min(cellEnd, args.width / 8);
+    int cx = cellBegin;
+    for (; cx < fullCells; ++cx) {
+        __m128i sumR = zero, sumG = zero, sumB = zero;
+        for (int y = 0; y < args.rows; ++y) {
+            __m128i r, g, b;
+            deinterleave8(args.pixels + y * args.pixelStride + static_cast<size_t>(cx) * 8 * args.channels, args.channels, r, g, b);
+            sumR = _mm_add_epi64(sumR, _mm_sad_epu8(r, zero));
+            sumG = _mm_add_epi64(sumG, _mm_sad_epu8(g, zero));
+            sumB = _mm_add_epi64(sumB, _mm_sad_epu8(b, zero));
+
+            float* lum = args.luminance + y * args.luminanceStride + cx * 8;
+            _mm_storeu_ps(lum, luminance4(r, g, b));
+            _mm_storeu_ps(lum + 4, luminance4(_mm_srli_si128(r, 4), _mm_srli_si128(g, 4), _mm_srli_si128(b, 4)));
+        }
+        storeCellAverage(args.downscale + cx * 4, _mm_cvtsi128_si32(sumR), _mm_cvtsi128_si32(sumG),
+                         _mm_cvtsi128_si32(sumB), 8 * args.rows);
+    }
+    if (cx < cellEnd) lumaDownscaleScalar(args, cx, cellEnd);
+}
+
+void blurRowSSE41(const float* luminance, int width, const float* taps, int radius, float* ping) {
+    // Pixels whose whole footprint lies inside the row take the vector path.
+    int x0 = std::min(radius, width);
+    int x1 = std::max(x0, width - radius);
+    blurSpanScalar(luminance, width, taps, radius, ping, 0, x0);
+    int x = x0;
+    for (; x + 4 <= x1; x += 4) {
+        __m128 blur1 = _mm_setzero_ps(), blur2 = _mm_setzero_ps();
+        for (int i = -radius; i <= radius; ++i) {
+            __m128 lum = _mm_loadu_ps(luminance + x + i);
+            blur1 = _mm_add_ps(blur1, _mm_mul_ps(lum, _mm_set1_ps(taps[(i + radius) * 2])));
+            blur2 = _mm_add_ps(blur2, _mm_mul_ps(lum, _mm_set1_ps(taps[(i + radius) * 2 + 1])));
+        }
+        _mm_storeu_ps(ping + x * 2, _mm_unpacklo_ps(blur1, blur2));
+        _mm_storeu_ps(ping + x * 2 + 4, _mm_unpackhi_ps(blur1, blur2));
+    }
+    blurSpanScalar(luminance, width, taps, radius, ping, x, width);
+}
+
+void blurDifferenceRowSSE41(const float* const* pingRows, int width, const float* taps, int radius,
+                            float tau, float threshold, float* dog) {
+    const __m128 tauV = _mm_set1_ps(tau);
+    const __m128 thresholdV = _mm_set1_ps(threshold);
+    const __m128 one = _mm_set1_ps(1.0f);
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        // ping is interleaved (narrow, wide), so each tap weighs pairs of lanes.
+        __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+        for (int i = 0; i <= 2 * radius; ++i) {
+            __m128 weights = _mm_castsi128_ps(_mm_unpacklo_epi64(tapPair(taps + i * 2), tapPair(taps + i * 2)));
+            const float* row = pingRows[i] + x * 2;
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(row), weights));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(row + 4), weights));
+        }
+        __m128 blur1 = _mm_shuffle_ps(acc0, acc1, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 blur2 = _mm_shuffle_ps(acc0, acc1, _MM_SHUFFLE(3, 1, 3, 1));
+        __m128 difference = _mm_sub_ps(blur1, _mm_mul_ps(tauV, blur2));
+        _mm_storeu_ps(dog + x, _mm_and_ps(_mm_cmpge_ps(difference, thresholdV), one));
+    }
+    blurDifferenceSpanScalar(pingRows, taps, radius, tau, threshold, dog, x, width);
+}
+
+void expandGlyphSSE41(uint64_t glyph, const unsigned char* foreground, const unsigned char* background,
+                      int columns, int rows, unsigned char* out, size_t outStride) {
+    if (columns < 8) {
+        expandGlyphScalar(glyph, foreground, background, columns, rows, out, outStride);
+        return;
+    }
+
+    // A row of 8 RGB pixels is 16 + 8 bytes; each byte tests the bit of its pixel.
+    unsigned char fg[24], bg[24];
+    for (int i = 0; i < 24; ++i) {
+        fg[i] = foreground[i % 3];
+        bg[i] = background[i % 3];
+    }
+    const __m128i fgLo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(fg));
+    const __m128i fgHi = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(fg + 16));
+    const __m128i bgLo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bg));
+    const __m128i bgHi = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(bg + 16));
+    const __m128i bitLo = _mm_setr_epi8(1, 1, 1, 2, 2, 2, 4, 4, 4, 8, 8, 8, 16, 16, 16, 32);
+    const __m128i bitHi = _mm_setr_epi8(32, 32, 64, 64, 64, -128, -128, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+    for (int y = 0; y < rows; ++y, out += outStride) {
+        __m128i bits = _mm_set1_epi8(static_cast<char>(glyph >> (y * 8)));
+        __m128i lo = _mm_blendv_epi8(bgLo, fgLo, _mm_cmpeq_epi8(_mm_and_si128(bits, bitLo), bitLo));
+        __m128i hi = _mm_blendv_epi8(bgHi, fgHi, _mm_cmpeq_epi8(_mm_and_si128(bits, bitHi), bitHi));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), lo);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + 16), hi);
+    }
+}
+
+void lumaDownscaleU8SSE41(const LumaDownscaleArgs& args, int cellBegin, int cellEnd) {
+    if (args.channels < 3) {
+        lumaDownscaleU8Scalar(args, cellBegin, cellEnd);
+        return;
+    }
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i weightR = _mm_set1_epi16(LUMA_R8), weightG = _mm_set1_epi16(LUMA_G8), weightB = _mm_set1_epi16(LUMA_B8);
+    const __m128i half = _mm_set1_epi16(128);
+    int fullCells = std::min(cellEnd, args.width / 8);
+    int cx = cellBegin;
+    for (; cx < fullCells; ++cx) {
+        __m128i sumR = zero, sumG = zero, sumB = zero;
+        for (int y = 0; y < args.rows; ++y) {
+            __m128i r, g, b;
+            deinterleave8(args.pixels + y * args.pixelStride + static_cast<size_t>(cx) * 8 * args.channels, args.channels, r, g, b);
+            sumR = _mm_add_epi64(sumR, _mm_sad_epu8(r, zero));
+            sumG = _mm_add_epi64(sumG, _mm_sad_epu8(g, zero));
+            sumB = _mm_add_epi64(sumB, _mm_sad_epu8(b, zero));
+            // At most 255 * 256, so the weighted sum fits 16 unsigned bits
+            __m128i lum = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_cvtepu8_epi16(r), weightR),
+                                                      _mm_mullo_epi16(_mm_cvtepu8_epi16(g), weightG)),
+                                        _mm_add_epi16(_mm_mullo_epi16(_mm_cvtepu8_epi16(b), weightB), half));
+            lum = _mm_srli_epi16(lum, 8);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(args.luminance8 + y * args.luminanceStride + cx * 8),
+                             _mm_packus_epi16(lum, lum));
+        }
+        storeCellAverage(args.downscale + cx * 4, _mm_cvtsi128_si32(sumR), _mm_cvtsi128_si32(sumG),
+                         _mm_cvtsi128_si32(sumB), 8 * args.rows);
+    }
+    if (cx < cellEnd) lumaDownscaleU8Scalar(args, cx, cellEnd);
+}
+
+void blurRowU16SSE41(const unsigned char* luminance, int width, const uint16_t* taps, int radius, uint16_t* ping) {
+    int x0 = std::min(radius, width);
+    int x1 = std::max(x0, width - radius);
+    blurSpanU16Scalar(luminance, width, taps, radius, ping, 0, x0);
+    int x = x0;
+    for (; x + 8 <= x1; x += 8) {
+        __m128i blur1 = _mm_setzero_si128(), blur2 = _mm_setzero_si128();
+        for (int i = -radius; i <= radius; ++i) {
+            __m128i lum = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(luminance + x + i));
+            lum = _mm_slli_epi16(_mm_cvtepu8_epi16(lum), 8);
+            blur1 = _mm_add_epi16(blur1, _mm_mulhi_epu16(lum, _mm_set1_epi16(taps[(i + radius) * 2])));
+            blur2 = _mm_add_epi16(blur2, _mm_mulhi_epu16(lum, _mm_set1_epi16(taps[(i + radius) * 2 + 1])));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(ping + x * 2), _mm_unpacklo_epi16(blur1, blur2));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(ping + x * 2 + 8), _mm_unpackhi_epi16(blur1, blur2));
+    }
+    blurSpanU16Scalar(luminance, width, taps, radius, ping, x, width);
+}
+
+void blurDifferenceRowU16SSE41(const uint16_t* const* pingRows, int width, const uint16_t* taps, int radius,
+                               int tauQ8, int thresholdQ, unsigned char* dog) {
+    // madd pairs (narrow, wide) >> 1 with (256, -tauQ8): the whole difference in one instruction
+    const __m128i scale = _mm_set1_epi32(static_cast<int>(256u | (static_cast<unsigned int>(-tauQ8) << 16)));
+    const __m128i threshold = _mm_set1_epi32(thresholdQ - 1);
+    const __m128i one = _mm_set1_epi8(1);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i acc0 = _mm_setzero_si128(), acc1 = _mm_setzero_si128();
+        for (int i = 0; i <= 2 * radius; ++i) {
+            __m128i weights = _mm_set1_epi32(static_cast<int>(taps[i * 2] | (static_cast<unsigned int>(taps[i * 2 + 1]) << 16)));
+            const uint16_t* row = pingRows[i] + x * 2;
+            acc0 = _mm_add_epi16(acc0, _mm_mulhi_epu16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row)), weights));
+            acc1 = _mm_add_epi16(acc1, _mm_mulhi_epu16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + 8)), weights));
+        }
+        __m128i edge0 = _mm_cmpgt_epi32(_mm_madd_epi16(_mm_srli_epi16(acc0, 1), scale), threshold);
+        __m128i edge1 = _mm_cmpgt_epi32(_mm_madd_epi16(_mm_srli_epi16(acc1, 1), scale), threshold);
+        __m128i edges = _mm_packs_epi32(edge0, edge1);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dog + x), _mm_and_si128(_mm_packs_epi16(edges, edges), one));
+    }
+    blurDifferenceSpanU16Scalar(pingRows, taps, radius, tauQ8, thresholdQ, dog, x, width);
+}
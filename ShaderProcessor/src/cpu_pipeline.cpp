@@ -0,0 +1,363 @@
+#include "cpu_pipeline.h"
+#include "cpu_stages.h"
+#include "cpu_kernels.h"
+#include "task_graph.h"
+#include <iostream>
+
+void buildSourceMap(int size, float offset, float zoom, std::vector<int>& map) {
+    map.resize(size);
+    for (int i = 0; i < size; ++i) {
+        float uv = (i + 0.5f) / size;
+        float zoomUV = ((uv * 2.0f - 1.0f) + offset * 2.0f) * zoom * 0.5f + 0.5f;
+        int source = static_cast<int>(std::floor(zoomUV * size));
+        map[i] = (source < 0 || source >= size) ? -1 : source;
+    }
+}
+
+void readSource(const CpuImage& input, int x, int y, float rgb[3]) {
+    if (x < 0 || y < 0) {
+        rgb[0] = rgb[1] = rgb[2] = 0.0f;
+        return;
+    }
+    const unsigned char* p = input.pixels + (static_cast<size_t>(y) * input.width + x) * input.channels;
+    if (input.channels < 3) {
+        rgb[0] = rgb[1] = rgb[2] = p[0] / 255.0f;
+    } else {
+        rgb[0] = p[0] / 255.0f;
+        rgb[1] = p[1] / 255.0f;
+        rgb[2] = p[2] / 255.0f;
+    }
+}
+
+void runCpuAnalysis(const CpuImage& input, const float* depth, const AsciiParams& params, ThreadPool& pool,
+                    CpuIntermediates& buffers) {
+    const int width = input.width;
+    const int height = input.height;
+    const int cellsX = (width + 7) / 8;
+    const int cellsY = (height + 7) / 8;
+    const size_t pixelCount = static_cast<size_t>(width) * height;
+
+    buffers.width = width;
+    buffers.height = height;
+    buffers.cellsX = cellsX;
+    buffers.cellsY = cellsY;
+    buffers.luminance.resize(pixelCount);
+    buffers.downscale.resize(static_cast<size_t>(cellsX) * cellsY * 4);
+    buffers.ping.resize(pixelCount * 2);
+    buffers.dog.resize(pixelCount);
+    buffers.normals.resize(depth ? pixelCount * 4 : 0);
+    buffers.edges.resize(pixelCount);
+    buffers.sobel.resize(pixelCount * 2);
+    buffers.cellEdges.resize(static_cast<size_t>(cellsX) * cellsY);
+
+    std::vector<int> mapX, mapY;
+    buildSourceMap(width, -params.offset[0], params.zoom, mapX);
+    buildSourceMap(height, params.offset[1], params.zoom, mapY);
+
+    buffers.dogWeights.update(params);
+    const float* taps = buffers.dogWeights.taps.data();
+    const int radius = buffers.dogWeights.radius;
+    const CpuKernels& kernels = cpuKernels();
+
+    auto clampX = [width](int x) { return std::min(std::max(x, 0), width - 1); };
+    auto clampY = [height](int y) { return std::min(std::max(y, 0), height - 1); };
+
+    const bool identityTransform = params.zoom == 1.0f && params.offset[0] == 0.0f && params.offset[1] == 0.0f;
+
+    // Every pass below covers a range of rows, or of cell rows, and runs once
+    // per strip in the task graph at the end of the function.
+
+    // PS_Luminance + PS_Downscale
+    auto lumaDownscale = [&](int cy0, int cy1) {
+        if (identityTransform) {
+            // in one pass over the source pixels
+            for (int cy = cy0; cy < cy1; ++cy) {
+                LumaDownscaleArgs args;
+                args.pixels = input.pixels + static_cast<size_t>(cy) * 8 * width * input.channels;
+                args.pixelStride = static_cast<size_t>(width) * input.channels;
+                args.channels = input.channels;
+                args.width = width;
+                args.rows = std::min(8, height - cy * 8);
+                args.luminance = &buffers.luminance[static_cast<size_t>(cy) * 8 * width];
+                args.luminanceStride = width;
+                args.downscale = &buffers.downscale[static_cast<size_t>(cy) * cellsX * 4];
+                kernels.lumaDownscale(args, 0, cellsX);
+            }
+            return;
+        }
+
+        float rgb[3];
+        for (int y = cy0 * 8; y < std::min(cy1 * 8, height); ++y) {
+            float* row = &buffers.luminance[static_cast<size_t>(y) * width];
+            for (int x = 0; x < width; ++x) {
+                readSource(input, mapX[x], mapY[y], rgb);
+                row[x] = asciiLuminance(rgb[0], rgb[1], rgb[2]);
+            }
+        }
+
+        // average colour of each 8x8 cell, luminance in w
+        for (int cy = cy0; cy < cy1; ++cy) {
+            for (int cx = 0; cx < cellsX; ++cx) {
+                float sum[3] = {0.0f, 0.0f, 0.0f};
+                int count = 0;
+                for (int y = cy * 8; y < std::min(cy * 8 + 8, height); ++y) {
+                    for (int x = cx * 8; x < std::min(cx * 8 + 8, width); ++x) {
+                        readSource(input, mapX[x], mapY[y], rgb);
+                        sum[0] += rgb[0];
+                        sum[1] += rgb[1];
+                        sum[2] += rgb[2];
+                        ++count;
+                    }
+                }
+                float* cell = &buffers.downscale[(static_cast<size_t>(cy) * cellsX + cx) * 4];
+                cell[0] = sum[0] / count;
+                cell[1] = sum[1] / count;
+                cell[2] = sum[2] / count;
+                cell[3] = asciiLuminance(cell[0], cell[1], cell[2]);
+            }
+        }
+    };
+
+    // PS_HorizontalBlur: one set of taps feeds both gaussians, into ping.rg
+    auto horizontalBlur = [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            kernels.blurRow(&buffers.luminance[static_cast<size_t>(y) * width], width, taps, radius,
+                            &buffers.ping[static_cast<size_t>(y) * width * 2]);
+        }
+    };
+
+    // PS_VerticalBlurAndDifference
+    auto verticalBlurAndDifference = [&](int y0, int y1) {
+        const float* pingRows[2 * DogWeights::MAX_RADIUS + 1];
+        for (int y = y0; y < y1; ++y) {
+            for (int i = -radius; i <= radius; ++i) {
+                pingRows[i + radius] = &buffers.ping[static_cast<size_t>(clampY(y + i)) * width * 2];
+            }
+            kernels.blurDifferenceRow(pingRows, width, taps, radius, params.tau, params.threshold,
+                                      &buffers.dog[static_cast<size_t>(y) * width]);
+        }
+    };
+
+    // PS_CalculateNormals: view-space normal from the depth plane, depth in w
+    auto calculateNormals = [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            for (int x = 0; x < width; ++x) {
+                float u = (x + 0.5f) / width - 0.5f;
+                float v = (y + 0.5f) / height - 0.5f;
+                float dc = depth[static_cast<size_t>(y) * width + x];
+                float dn = depth[static_cast<size_t>(clampY(y - 1)) * width + x];
+                float de = depth[static_cast<size_t>(y) * width + clampX(x + 1)];
+                float a[3] = {u * dc - u * dn, v * dc - (v - 1.0f / height) * dn, dc - dn};
+                float b[3] = {u * dc - (u + 1.0f / width) * de, v * dc - v * de, dc - de};
+                float n[3] = {a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0]};
+                float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                float scale = length > 0.0f ? 1.0f / length : 0.0f;
+                float* out = &buffers.normals[(static_cast<size_t>(y) * width + x) * 4];
+                out[0] = n[0] * scale;
+                out[1] = n[1] * scale;
+                out[2] = n[2] * scale;
+                out[3] = dc;
+            }
+        }
+    };
+
+    // PS_EdgeDetect: DoG edges, toggled by depth/normal discontinuities
+    auto edgeDetect = [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            for (int x = 0; x < width; ++x) {
+                float edge = 0.0f;
+                if (depth) {
+                    const float* c = &buffers.normals[(static_cast<size_t>(y) * width + x) * 4];
+                    float depthSum = 0.0f, normalSum = 0.0f;
+                    for (int dy = -1; dy <= 1; ++dy) {
+                        for (int dx = -1; dx <= 1; ++dx) {
+                            const float* n = &buffers.normals[(static_cast<size_t>(clampY(y + dy)) * width + clampX(x + dx)) * 4];
+                            depthSum += std::fabs(n[3] - c[3]);
+                            normalSum += std::fabs(n[0] - c[0]) + std::fabs(n[1] - c[1]) + std::fabs(n[2] - c[2]);
+                        }
+                    }
+                    if (params.useDepth && depthSum > params.depthThreshold) edge = 1.0f;
+                    if (params.useNormals && normalSum > params.normalThreshold) edge = 1.0f;
+                }
+                size_t i = static_cast<size_t>(y) * width + x;
+                buffers.edges[i] = asciiSaturate(std::fabs(buffers.dog[i] - edge));
+            }
+        }
+    };
+
+    // PS_HorizontalSobel, into ping like the GL pipeline
+    auto horizontalSobel = [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            const float* row = &buffers.edges[static_cast<size_t>(y) * width];
+            float* out = &buffers.ping[static_cast<size_t>(y) * width * 2];
+            for (int x = 0; x < width; ++x) {
+                float lum1 = row[clampX(x - 1)];
+                float lum2 = row[x];
+                float lum3 = row[clampX(x + 1)];
+                out[x * 2] = 3.0f * lum1 - 3.0f * lum3;
+                out[x * 2 + 1] = 3.0f * lum1 + 10.0f * lum2 + 3.0f * lum3;
+            }
+        }
+    };
+
+    // PS_VerticalSobel: gradient angle in r, 1 in g where the gradient exists
+    auto verticalSobel = [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            const float* above = &buffers.ping[static_cast<size_t>(clampY(y - 1)) * width * 2];
+            const float* centre = &buffers.ping[static_cast<size_t>(y) * width * 2];
+            const float* below = &buffers.ping[static_cast<size_t>(clampY(y + 1)) * width * 2];
+            float* out = &buffers.sobel[static_cast<size_t>(y) * width * 2];
+            for (int x = 0; x < width; ++x) {
+                float gx = 3.0f * above[x * 2] + 10.0f * centre[x * 2] + 3.0f * below[x * 2];
+                float gy = 3.0f * above[x * 2 + 1] - 3.0f * below[x * 2 + 1];
+                bool valid = gx != 0.0f || gy != 0.0f;
+                if (valid && depth && params.depthCutoff > 0.0f) {
+                    valid = depth[static_cast<size_t>(y) * width + x] * 1000.0f <= params.depthCutoff;
+                }
+                out[x * 2] = valid ? std::atan2(gy, gx) : 0.0f;
+                out[x * 2 + 1] = valid ? 1.0f : 0.0f;
+            }
+        }
+    };
+
+    // CS_RenderASCII, first half: most common edge direction of each cell
+    auto cellVote = [&](int cy0, int cy1) {
+        for (int cy = cy0; cy < cy1; ++cy) {
+            for (int cx = 0; cx < cellsX; ++cx) {
+                uint64_t planes[4] = {0, 0, 0, 0};
+                for (int y = cy * 8; y < std::min(cy * 8 + 8, height); ++y) {
+                    const float* row = &buffers.sobel[static_cast<size_t>(y) * width * 2];
+                    for (int x = cx * 8; x < std::min(cx * 8 + 8, width); ++x) {
+                        int direction = asciiEdgeDirection(row[x * 2], row[x * 2 + 1]);
+                        if (direction >= 0) planes[direction] |= asciiCellBit(x, y);
+                    }
+                }
+                int commonEdgeIndex = asciiCellVote(planes, params.edgeThreshold);
+                buffers.cellEdges[static_cast<size_t>(cy) * cellsX + cx] = commonEdgeIndex;
+            }
+        }
+    };
+
+    // One task per pass and strip. A task waits only for the strips its
+    // stencil reads, halo rows included, instead of for the whole previous
+    // pass, so a strip can reach the vote while others are still blurring.
+    TaskGraph graph;
+    const int strips = (cellsY + CPU_STRIP_CELL_ROWS - 1) / CPU_STRIP_CELL_ROWS;
+    const int stripRows = CPU_STRIP_CELL_ROWS * 8;
+    auto stripTasks = [&](const std::function<void(int, int)>& pass, bool cellRows) {
+        std::vector<int> ids(strips);
+        for (int strip = 0; strip < strips; ++strip) {
+            int begin = cellRows ? strip * CPU_STRIP_CELL_ROWS : strip * stripRows;
+            int end = cellRows ? std::min(begin + CPU_STRIP_CELL_ROWS, cellsY) : std::min(begin + stripRows, height);
+            ids[strip] = graph.add([pass, begin, end] { pass(begin, end); });
+        }
+        return ids;
+    };
+    // Strip s of stage waits for every strip of prerequisite within halo rows of it.
+    auto dependOnRows = [&](const std::vector<int>& stage, const std::vector<int>& prerequisite, int halo) {
+        for (int strip = 0; strip < strips; ++strip) {
+            int first = std::max(0, strip * stripRows - halo) / stripRows;
+            int last = std::min(height - 1, strip * stripRows + stripRows - 1 + halo) / stripRows;
+            for (int other = first; other <= last; ++other) graph.depend(stage[strip], prerequisite[other]);
+        }
+    };
+
+    std::vector<int> lumaTasks = stripTasks(lumaDownscale, true);
+    std::vector<int> blurTasks = stripTasks(horizontalBlur, false);
+    std::vector<int> dogTasks = stripTasks(verticalBlurAndDifference, false);
+    std::vector<int> edgeTasks = stripTasks(edgeDetect, false);
+    std::vector<int> sobelTasks = stripTasks(horizontalSobel, false);
+    std::vector<int> angleTasks = stripTasks(verticalSobel, false);
+    std::vector<int> voteTasks = stripTasks(cellVote, true);
+    dependOnRows(blurTasks, lumaTasks, 0);
+    dependOnRows(dogTasks, blurTasks, radius);
+    dependOnRows(edgeTasks, dogTasks, 0);
+    if (depth) {
+        std::vector<int> normalTasks = stripTasks(calculateNormals, false);
+        dependOnRows(edgeTasks, normalTasks, 1);
+    }
+    dependOnRows(sobelTasks, edgeTasks, 0);
+    // The horizontal Sobel overwrites ping, so it also waits until no blur
+    // still reads those rows.
+    dependOnRows(sobelTasks, dogTasks, radius);
+    dependOnRows(angleTasks, sobelTasks, 1);
+    dependOnRows(voteTasks, angleTasks, 0);
+    graph.run(pool);
+}
+
+void composeCells(int width, int height, const float* downscale, const int* cellEdges, const float* depth,
+                  const AsciiParams& params, const GlyphAtlas& edgesAtlas, const GlyphAtlas& fillAtlas,
+                  ThreadPool& pool, std::vector<unsigned char>& output) {
+    const int cellsX = (width + 7) / 8;
+    const int cellsY = (height + 7) / 8;
+    const CpuKernels& kernels = cpuKernels();
+    output.resize(static_cast<size_t>(width) * height * 3);
+
+    // CS_RenderASCII, second half: glyph lookup and colouring. A glyph is
+    // one bit per pixel, so without fog every pixel of a cell is one of two
+    // colours and the cell is expanded from its mask in one go.
+    if (!depth) {
+        pool.parallelFor(0, cellsY, 1, [&](int cy0, int cy1) {
+            for (int cy = cy0; cy < cy1; ++cy) {
+                for (int cx = 0; cx < cellsX; ++cx) {
+                    size_t cell = static_cast<size_t>(cy) * cellsX + cx;
+                    const float* info = &downscale[cell * 4];
+                    uint64_t glyph = asciiCellGlyph(cellEdges[cell], info[3], params, edgesAtlas, fillAtlas);
+                    unsigned char foreground[3], background[3];
+                    asciiComposePixel(1.0f, info, 1.0f, params, foreground);
+                    asciiComposePixel(0.0f, info, 1.0f, params, background);
+                    kernels.expandGlyph(glyph, foreground, background, std::min(8, width - cx * 8),
+                                        std::min(8, height - cy * 8),
+                                        &output[(static_cast<size_t>(cy) * 8 * width + cx * 8) * 3],
+                                        static_cast<size_t>(width) * 3);
+                }
+            }
+        });
+        return;
+    }
+
+    const float fogScale = params.depthFalloff * 0.005f / std::sqrt(std::log(2.0f));
+    pool.parallelFor(0, height, 8, [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            int cy = y / 8;
+            unsigned char* out = &output[static_cast<size_t>(y) * width * 3];
+            for (int x = 0; x < width; ++x) {
+                int cx = x / 8;
+                size_t cell = static_cast<size_t>(cy) * cellsX + cx;
+                const float* info = &downscale[cell * 4];
+                uint64_t glyph = asciiCellGlyph(cellEdges[cell], info[3], params, edgesAtlas, fillAtlas);
+                float ascii = glyphBit(glyph, x & 7, y & 7) ? 1.0f : 0.0f;
+
+                int sx = std::min(cx * 8 + 4, width - 1);
+                int sy = std::min(cy * 8 + 4, height - 1);
+                float z = depth[static_cast<size_t>(sy) * width + sx] * 1000.0f;
+                float fog = fogScale * std::max(0.0f, z - params.depthOffset);
+                asciiComposePixel(ascii, info, std::exp2(-fog * fog), params, out + x * 3);
+            }
+        }
+    });
+}
+
+void runCpuPipeline(const CpuImage& input, const float* depth, const AsciiParams& params,
+                    const GlyphAtlas& edgesAtlas, const GlyphAtlas& fillAtlas, ThreadPool& pool,
+                    CpuIntermediates& buffers, std::vector<unsigned char>& output) {
+    runCpuAnalysis(input, depth, params, pool, buffers);
+    composeCells(input.width, input.height, buffers.downscale.data(), buffers.cellEdges.data(), depth, params,
+                 edgesAtlas, fillAtlas, pool, output);
+}
+
+bool processFrameCPU(const CpuImage& input, const char* outputPath, OutputFormat format, const AsciiParams& params,
+                     const GlyphAtlas& edgesAtlas, const GlyphAtlas& fillAtlas, ThreadPool& pool,
+                     CpuIntermediates& buffers, ImageWriter& writer) {
+    if (format != OutputFormat::Image) {
+        runCpuAnalysis(input, nullptr, params, pool, buffers);
+        return writeCellText(outputPath, format, buffers.cellsX, buffers.cellsY, buffers.cellEdges.data(),
+                             buffers.downscale.data(), params);
+    }
+
+    std::vector<unsigned char> outputData;
+    runCpuPipeline(input, nullptr, params, edgesAtlas, fillAtlas, pool, buffers, outputData);
+
+    writer.write(outputPath, std::move(outputData), input.width, input.height, 3);
+    return true;
+}
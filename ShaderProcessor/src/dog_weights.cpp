@@ -0,0 +1,45 @@
+#include "dog_weights.h"
+#include "cpu_stages.h"
+
+bool DogWeights::update(const AsciiParams& params) {
+    int newRadius = std::min(std::max(params.kernelSize, 0), MAX_RADIUS);
+    if (newRadius == radius && params.sigma == sigma && params.sigmaScale == sigmaScale) {
+        return false;
+    }
+    radius = newRadius;
+    sigma = params.sigma;
+    sigmaScale = params.sigmaScale;
+
+    taps.assign(2 * tapCount(), 0.0f);
+    float sum[2] = {0.0f, 0.0f};
+    float sigmas[2] = {params.sigma, params.sigma * params.sigmaScale};
+    for (int i = -radius; i <= radius; ++i) {
+        for (int k = 0; k < 2; ++k) {
+            float weight = asciiGaussian(sigmas[k], static_cast<float>(i));
+            taps[(i + radius) * 2 + k] = weight;
+            sum[k] += weight;
+        }
+    }
+    for (int k = 0; k < 2; ++k) {
+        // A zero sigma (the slider allows it) has no finite taps; treat it as no blur.
+        bool degenerate = !(sum[k] > 0.0f) || !std::isfinite(sum[k]);
+        for (int i = 0; i < tapCount(); ++i) {
+            float& tap = taps[i * 2 + k];
+            tap = degenerate ? (i == radius ? 1.0f : 0.0f) : tap / sum[k];
+        }
+    }
+    return true;
+}
+
+void quantizeDogWeights(const DogWeights& weights, std::vector<uint16_t>& taps) {
+    taps.resize(weights.taps.size());
+    for (int k = 0; k < 2; ++k) {
+        long sum = 0;
+        for (int i = 0; i < weights.tapCount(); ++i) {
+            long tap = std::lround(weights.taps[i * 2 + k] * 65535.0f);
+            taps[i * 2 + k] = static_cast<uint16_t>(tap);
+            sum += tap;
+        }
+        taps[weights.radius * 2 + k] = static_cast<uint16_t>(taps[weights.radius * 2 + k] + (65535 - sum));
+    }
+}
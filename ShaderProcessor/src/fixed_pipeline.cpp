@@ -0,0 +1,231 @@
+#include "fixed_pipeline.h"
+#include "cpu_stages.h"
+#include "cpu_kernels.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+// |Gx| and |Gy| of the integer Sobel never exceed 48: 3 + 10 + 3 times the
+// horizontal pass's 3 (Gx), or 3 times its 16 (Gy).
+const int SOBEL_LIMIT = 48;
+const int SOBEL_SPAN = 2 * SOBEL_LIMIT + 1;
+
+// Edge direction of every gradient the integer Sobel can produce, classified
+// once by the float code, so no atan2 runs per pixel and the result matches
+// the float pipeline exactly.
+static const signed char* directionTable() {
+    static const std::vector<signed char> table = [] {
+        std::vector<signed char> directions(SOBEL_SPAN * SOBEL_SPAN);
+        for (int gy = -SOBEL_LIMIT; gy <= SOBEL_LIMIT; ++gy) {
+            for (int gx = -SOBEL_LIMIT; gx <= SOBEL_LIMIT; ++gx) {
+                bool valid = gx != 0 || gy != 0;
+                float theta = valid ? std::atan2(static_cast<float>(gy), static_cast<float>(gx)) : 0.0f;
+                directions[(gy + SOBEL_LIMIT) * SOBEL_SPAN + gx + SOBEL_LIMIT] =
+                    static_cast<signed char>(asciiEdgeDirection(theta, valid ? 1.0f : 0.0f));
+            }
+        }
+        return directions;
+    }();
+    return table.data();
+}
+
+void runFixedAnalysis(const CpuImage& source, const AsciiParams& params, ThreadPool& pool,
+                      FixedIntermediates& buffers) {
+    const int width = source.width;
+    const int height = source.height;
+    const int cellsX = (width + 7) / 8;
+    const int cellsY = (height + 7) / 8;
+    const size_t pixelCount = static_cast<size_t>(width) * height;
+
+    buffers.width = width;
+    buffers.height = height;
+    buffers.cellsX = cellsX;
+    buffers.cellsY = cellsY;
+    buffers.luminance.resize(pixelCount);
+    buffers.downscale.resize(static_cast<size_t>(cellsX) * cellsY * 4);
+    buffers.ping.resize(pixelCount * 2);
+    buffers.dog.resize(pixelCount);
+    buffers.sobel.resize(pixelCount * 2);
+    buffers.cellEdges.resize(static_cast<size_t>(cellsX) * cellsY);
+
+    if (buffers.dogWeights.update(params) || buffers.taps.empty()) {
+        quantizeDogWeights(buffers.dogWeights, buffers.taps);
+    }
+    const uint16_t* taps = buffers.taps.data();
+    const int radius = buffers.dogWeights.radius;
+    const int tauQ8 = static_cast<int>(std::min(std::max(std::lround(params.tau * 256.0f), -32767L), 32767L));
+    const int thresholdQ = static_cast<int>(
+        std::min(std::max(std::ceil(params.threshold * 255.0 * 128.0 * 256.0), INT_MIN + 1.0), static_cast<double>(INT_MAX)));
+    const CpuKernels& kernels = cpuKernels();
+
+    auto clampX = [width](int x) { return std::min(std::max(x, 0), width - 1); };
+    auto clampY = [height](int y) { return std::min(std::max(y, 0), height - 1); };
+
+    // transformUV: gather the zoomed or offset source once, after which every
+    // stage is the identity path
+    CpuImage input = source;
+    if (params.zoom != 1.0f || params.offset[0] != 0.0f || params.offset[1] != 0.0f) {
+        std::vector<int> mapX, mapY;
+        buildSourceMap(width, -params.offset[0], params.zoom, mapX);
+        buildSourceMap(height, params.offset[1], params.zoom, mapY);
+        buffers.remapped.resize(pixelCount * 3);
+        pool.parallelFor(0, height, 1, [&](int y0, int y1) {
+            for (int y = y0; y < y1; ++y) {
+                unsigned char* out = &buffers.remapped[static_cast<size_t>(y) * width * 3];
+                for (int x = 0; x < width; ++x, out += 3) {
+                    if (mapX[x] < 0 || mapY[y] < 0) {
+                        out[0] = out[1] = out[2] = 0;
+                        continue;
+                    }
+                    const unsigned char* p = source.pixels + (static_cast<size_t>(mapY[y]) * width + mapX[x]) * source.channels;
+                    out[0] = p[0];
+                    out[1] = source.channels < 3 ? p[0] : p[1];
+                    out[2] = source.channels < 3 ? p[0] : p[2];
+                }
+            }
+        });
+        input.pixels = buffers.remapped.data();
+        input.channels = 3;
+    }
+
+    // PS_Luminance + PS_Downscale
+    pool.parallelFor(0, cellsY, 1, [&](int cy0, int cy1) {
+        for (int cy = cy0; cy < cy1; ++cy) {
+            LumaDownscaleArgs args;
+            args.pixels = input.pixels + static_cast<size_t>(cy) * 8 * width * input.channels;
+            args.pixelStride = static_cast<size_t>(width) * input.channels;
+            args.channels = input.channels;
+            args.width = width;
+            args.rows = std::min(8, height - cy * 8);
+            args.luminance = nullptr;
+            args.luminance8 = &buffers.luminance[static_cast<size_t>(cy) * 8 * width];
+            args.luminanceStride = width;
+            args.downscale = &buffers.downscale[static_cast<size_t>(cy) * cellsX * 4];
+            kernels.lumaDownscaleU8(args, 0, cellsX);
+        }
+    });
+
+    // PS_HorizontalBlur
+    pool.parallelFor(0, height, 1, [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            kernels.blurRowU16(&buffers.luminance[static_cast<size_t>(y) * width], width, taps, radius,
+                               &buffers.ping[static_cast<size_t>(y) * width * 2]);
+        }
+    });
+
+    // PS_VerticalBlurAndDifference; without depth PS_EdgeDetect passes it through
+    pool.parallelFor(0, height, 1, [&](int y0, int y1) {
+        const uint16_t* pingRows[2 * DogWeights::MAX_RADIUS + 1];
+        for (int y = y0; y < y1; ++y) {
+            for (int i = -radius; i <= radius; ++i) {
+                pingRows[i + radius] = &buffers.ping[static_cast<size_t>(clampY(y + i)) * width * 2];
+            }
+            kernels.blurDifferenceRowU16(pingRows, width, taps, radius, tauQ8, thresholdQ,
+                                         &buffers.dog[static_cast<size_t>(y) * width]);
+        }
+    });
+
+    // PS_HorizontalSobel
+    pool.parallelFor(0, height, 1, [&](int y0, int y1) {
+        for (int y = y0; y < y1; ++y) {
+            const unsigned char* row = &buffers.dog[static_cast<size_t>(y) * width];
+            int8_t* out = &buffers.sobel[static_cast<size_t>(y) * width * 2];
+            for (int x = 0; x < width; ++x) {
+                int lum1 = row[clampX(x - 1)];
+                int lum2 = row[x];
+                int lum3 = row[clampX(x + 1)];
+                out[x * 2] = static_cast<int8_t>(3 * lum1 - 3 * lum3);
+                out[x * 2 + 1] = static_cast<int8_t>(3 * lum1 + 10 * lum2 + 3 * lum3);
+            }
+        }
+    });
+
+    // PS_VerticalSobel and the first half of CS_RenderASCII, one cell row at a time
+    const signed char* directions = directionTable();
+    pool.parallelFor(0, cellsY, 1, [&](int cy0, int cy1) {
+        std::vector<uint64_t> planes(static_cast<size_t>(cellsX) * 4);
+        for (int cy = cy0; cy < cy1; ++cy) {
+            std::fill(planes.begin(), planes.end(), 0);
+            for (int y = cy * 8; y < std::min(cy * 8 + 8, height); ++y) {
+                const int8_t* above = &buffers.sobel[static_cast<size_t>(clampY(y - 1)) * width * 2];
+                const int8_t* centre = &buffers.sobel[static_cast<size_t>(y) * width * 2];
+                const int8_t* below = &buffers.sobel[static_cast<size_t>(clampY(y + 1)) * width * 2];
+                for (int x = 0; x < width; ++x) {
+                    int gx = 3 * above[x * 2] + 10 * centre[x * 2] + 3 * below[x * 2];
+                    int gy = 3 * above[x * 2 + 1] - 3 * below[x * 2 + 1];
+                    int direction = directions[(gy + SOBEL_LIMIT) * SOBEL_SPAN + gx + SOBEL_LIMIT];
+                    if (direction >= 0) planes[(x >> 3) * 4 + direction] |= asciiCellBit(x, y);
+                }
+            }
+            for (int cx = 0; cx < cellsX; ++cx) {
+                buffers.cellEdges[static_cast<size_t>(cy) * cellsX + cx] =
+                    asciiCellVote(&planes[cx * 4], params.edgeThreshold);
+            }
+        }
+    });
+}
+
+void runFixedPipeline(const CpuImage& input, const AsciiParams& params, const GlyphAtlas& edgesAtlas,
+                      const GlyphAtlas& fillAtlas, ThreadPool& pool, FixedIntermediates& buffers,
+                      std::vector<unsigned char>& output) {
+    runFixedAnalysis(input, params, pool, buffers);
+    composeCells(input.width, input.height, buffers.downscale.data(), buffers.cellEdges.data(), nullptr, params,
+                 edgesAtlas, fillAtlas, pool, output);
+}
+
+FixedErrorReport measureFixedError(const CpuImage& input, const AsciiParams& params, const GlyphAtlas& edgesAtlas,
+                                   const GlyphAtlas& fillAtlas, ThreadPool& pool, FixedIntermediates& fixedBuffers,
+                                   std::vector<unsigned char>& fixedOutput) {
+    CpuIntermediates floatBuffers;
+    std::vector<unsigned char> floatOutput;
+    runFixedPipeline(input, params, edgesAtlas, fillAtlas, pool, fixedBuffers, fixedOutput);
+    runCpuPipeline(input, nullptr, params, edgesAtlas, fillAtlas, pool, floatBuffers, floatOutput);
+
+    FixedErrorReport report;
+    size_t pixelCount = fixedBuffers.dog.size();
+    size_t dogMismatches = 0, pixelMismatches = 0, cellMismatches = 0;
+    for (size_t i = 0; i < pixelCount; ++i) {
+        if (fixedBuffers.dog[i] != (floatBuffers.dog[i] != 0.0f ? 1 : 0)) ++dogMismatches;
+        bool differs = false;
+        for (int c = 0; c < 3; ++c) {
+            int error = std::abs(fixedOutput[i * 3 + c] - floatOutput[i * 3 + c]);
+            report.maxChannelError = std::max(report.maxChannelError, error);
+            differs = differs || error != 0;
+        }
+        if (differs) ++pixelMismatches;
+    }
+    for (size_t i = 0; i < fixedBuffers.cellEdges.size(); ++i) {
+        if (fixedBuffers.cellEdges[i] != floatBuffers.cellEdges[i]) ++cellMismatches;
+    }
+    report.dogMismatch = static_cast<double>(dogMismatches) / pixelCount;
+    report.pixelMismatch = static_cast<double>(pixelMismatches) / pixelCount;
+    report.cellMismatch = static_cast<double>(cellMismatches) / fixedBuffers.cellEdges.size();
+    return report;
+}
+
+bool processFrameFixed(const CpuImage& input, const char* outputPath, OutputFormat format, const AsciiParams& params,
+                       const GlyphAtlas& edgesAtlas, const GlyphAtlas& fillAtlas, ThreadPool& pool,
+                       FixedIntermediates& buffers, ImageWriter& writer, bool compare) {
+    // The comparison runs the whole fixed pipeline already; its result is
+    // what gets written.
+    std::vector<unsigned char> outputData;
+    if (compare) {
+        FixedErrorReport report = measureFixedError(input, params, edgesAtlas, fillAtlas, pool, buffers, outputData);
+        std::cout << "Fixed point vs float: " << report.dogMismatch * 100.0 << "% DoG pixels, "
+                  << report.cellMismatch * 100.0 << "% cells, " << report.pixelMismatch * 100.0
+                  << "% output pixels differ, max channel error " << report.maxChannelError << std::endl;
+    } else if (format != OutputFormat::Image) {
+        runFixedAnalysis(input, params, pool, buffers);
+    } else {
+        runFixedPipeline(input, params, edgesAtlas, fillAtlas, pool, buffers, outputData);
+    }
+
+    if (format != OutputFormat::Image) {
+        return writeCellText(outputPath, format, buffers.cellsX, buffers.cellsY, buffers.cellEdges.data(),
+                             buffers.downscale.data(), params);
+    }
+    writer.write(outputPath, std::move(outputData), input.width, input.height, 3);
+    return true;
+}
@@ -0,0 +1,135 @@
+#include "frame_sequence.h"
+#include <algorithm>
+#include <cctype>
+#include <dirent.h>
+#include <glob.h>
+#include <iostream>
+#include <sys/stat.h>
+
+// Position and length of the %d / %0Nd field, npos if there is none. Any
+// other % sequence is taken literally.
+static size_t findField(const std::string& path, size_t& length) {
+    for (size_t i = path.find('%'); i != std::string::npos; i = path.find('%', i + 1)) {
+        size_t end = i + 1;
+        while (end < path.size() && path[end] >= '0' && path[end] <= '9') ++end;
+        if (end < path.size() && path[end] == 'd') {
+            length = end + 1 - i;
+            return i;
+        }
+    }
+    return std::string::npos;
+}
+
+bool isSequencePattern(const std::string& path) {
+    size_t length;
+    return findField(path, length) != std::string::npos;
+}
+
+std::string sequencePath(const std::string& pattern, int index) {
+    size_t length;
+    size_t field = findField(pattern, length);
+    if (field == std::string::npos) return pattern;
+
+    int width = length > 2 ? std::stoi(pattern.substr(field + 1, length - 2)) : 0;
+    std::string number = std::to_string(index);
+    if (static_cast<int>(number.size()) < width) number.insert(0, width - number.size(), '0');
+    return pattern.substr(0, field) + number + pattern.substr(field + length);
+}
+
+static bool fileExists(const std::string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode);
+}
+
+static bool isDirectory(const std::string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+// outputPath with a frame number field in front of its extension, unless it has one.
+static std::string outputPatternFor(const std::string& outputPath) {
+    std::string outputPattern = outputPath;
+    if (!isSequencePattern(outputPattern)) {
+        size_t slash = outputPattern.find_last_of('/');
+        size_t dot = outputPattern.find_last_of('.');
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) dot = outputPattern.size();
+        outputPattern.insert(dot, "%04d");
+    }
+    return outputPattern;
+}
+
+bool expandSequence(const std::string& inputPattern, const std::string& outputPath, FrameSequence& sequence) {
+    std::string outputPattern = outputPatternFor(outputPath);
+
+    sequence.inputs.clear();
+    sequence.outputs.clear();
+    int index = fileExists(sequencePath(inputPattern, 0)) ? 0 : 1;
+    for (;; ++index) {
+        std::string input = sequencePath(inputPattern, index);
+        if (!fileExists(input)) break;
+        sequence.inputs.push_back(input);
+        sequence.outputs.push_back(sequencePath(outputPattern, index));
+    }
+    if (sequence.inputs.empty()) {
+        std::cerr << "No frames match " << inputPattern << std::endl;
+        return false;
+    }
+    std::cout << "Sequence of " << sequence.inputs.size() << " frames: " << sequence.inputs.front() << " to "
+              << sequence.inputs.back() << std::endl;
+    return true;
+}
+
+bool isFileList(const std::string& path) {
+    return path.find_first_of("*?[") != std::string::npos || isDirectory(path);
+}
+
+static bool isImageFile(const std::string& name) {
+    static const char* const extensions[] = {".png", ".jpg", ".jpeg", ".bmp", ".tga", ".gif",
+                                             ".psd", ".hdr", ".pic", ".pnm", ".ppm", ".pgm"};
+    size_t dot = name.find_last_of('.');
+    if (dot == std::string::npos) return false;
+    std::string extension = name.substr(dot);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    for (const char* known : extensions) {
+        if (extension == known) return true;
+    }
+    return false;
+}
+
+bool expandFileList(const std::string& input, const std::string& outputPath, FrameSequence& sequence) {
+    std::vector<std::string> files;
+    if (isDirectory(input)) {
+        std::string directory = input.back() == '/' ? input : input + "/";
+        if (DIR* dir = opendir(input.c_str())) {
+            while (dirent* entry = readdir(dir)) {
+                std::string path = directory + entry->d_name;
+                if (isImageFile(entry->d_name) && fileExists(path)) files.push_back(path);
+            }
+            closedir(dir);
+        }
+    } else {
+        glob_t matches;
+        if (glob(input.c_str(), 0, nullptr, &matches) == 0) {
+            for (size_t i = 0; i < matches.gl_pathc; ++i) {
+                if (fileExists(matches.gl_pathv[i])) files.push_back(matches.gl_pathv[i]);
+            }
+        }
+        globfree(&matches);
+    }
+    std::sort(files.begin(), files.end());
+
+    std::string outputPattern = outputPatternFor(outputPath);
+    sequence.inputs = files;
+    sequence.outputs.clear();
+    for (size_t i = 0; i < files.size(); ++i) {
+        sequence.outputs.push_back(sequencePath(outputPattern, static_cast<int>(i) + 1));
+    }
+    if (sequence.inputs.empty()) {
+        std::cerr << "No images in " << input << std::endl;
+        return false;
+    }
+    std::cout << "Sequence of " << sequence.inputs.size() << " frames: " << sequence.inputs.front() << " to "
+              << sequence.inputs.back() << std::endl;
+    return true;
+}
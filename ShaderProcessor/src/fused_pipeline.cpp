@@ -0,0 +1,270 @@
+#include "fused_pipeline.h"
+#include "cpu_stages.h"
+#include "cpu_kernels.h"
+#include <iostream>
+
+// Per-frame state shared by every tile.
+struct FusedFrame {
+    const CpuImage* input;
+    const AsciiParams* params;
+    const GlyphAtlas* edgesAtlas;
+    const GlyphAtlas* fillAtlas;
+    const CpuKernels* kernels;
+    DogWeights weights;
+    bool identityTransform;
+    std::vector<int> mapX, mapY;
+    int cellsX, cellsY, tilesX, tilesY;
+    int haloCells;  // cells either side of a tile covering the blur and Sobel halo
+    unsigned char* output;
+    int* cellEdges;          // for text output: the per-cell results instead of pixels
+    float* cellDownscale;
+};
+
+// Scratch for one tile, reused by every tile of a band.
+struct TileScratch {
+    std::vector<float> luminance;  // segment columns, rows [lumY0, lumY1)
+    std::vector<float> ping;       // the same rows, (narrow, wide) interleaved
+    std::vector<float> dog;        // segment columns, rows [dogY0, dogY1)
+    std::vector<float> gradient;   // PS_HorizontalSobel (Gx, Gy), tile columns, same rows as dog
+    std::vector<float> downscale;  // RGBA per segment cell, one row of them per cell row
+    std::vector<float> haloCells;  // cell averages of single halo rows, discarded
+    std::vector<uint64_t> planes;  // edge direction bit-planes per tile cell, see asciiCellVote
+    std::vector<int> cellEdges;    // winning direction per tile cell, -1 for none
+};
+
+static void runTile(const FusedFrame& frame, int ty, int tx, TileScratch& scratch) {
+    const CpuImage& input = *frame.input;
+    const AsciiParams& params = *frame.params;
+    const int width = input.width;
+    const int height = input.height;
+    const int radius = frame.weights.radius;
+    const float* taps = frame.weights.taps.data();
+
+    // Tile cells and pixels, and the cell-aligned segment of columns its halo reads
+    const int cx0 = tx * FUSED_TILE_CELLS;
+    const int cx1 = std::min(frame.cellsX, cx0 + FUSED_TILE_CELLS);
+    const int x0 = cx0 * 8;
+    const int x1 = std::min(width, cx1 * 8);
+    const int segmentCell0 = std::max(0, cx0 - frame.haloCells);
+    const int sx0 = segmentCell0 * 8;
+    const int sx1 = std::min(width, (cx1 + frame.haloCells) * 8);
+    const int segmentWidth = sx1 - sx0;
+    const int segmentCells = (segmentWidth + 7) / 8;
+    const int tileWidth = x1 - x0;
+    const int tileCells = cx1 - cx0;
+
+    // Rows: the cell rows, one Sobel row either side, and the blur radius around those
+    const int cy0 = ty * FUSED_TILE_CELL_ROWS;
+    const int cy1 = std::min(frame.cellsY, cy0 + FUSED_TILE_CELL_ROWS);
+    const int y0 = cy0 * 8;
+    const int y1 = std::min(height, cy1 * 8);
+    const int dogY0 = std::max(0, y0 - 1);
+    const int dogY1 = std::min(height, y1 + 1);
+    const int lumY0 = std::max(0, dogY0 - radius);
+    const int lumY1 = std::min(height, dogY1 + radius);
+
+    auto clampX = [width](int x) { return std::min(std::max(x, 0), width - 1); };
+    auto clampY = [height](int y) { return std::min(std::max(y, 0), height - 1); };
+
+    scratch.luminance.resize(static_cast<size_t>(lumY1 - lumY0) * segmentWidth);
+    scratch.ping.resize(scratch.luminance.size() * 2);
+    scratch.dog.resize(static_cast<size_t>(dogY1 - dogY0) * segmentWidth);
+    scratch.gradient.resize(static_cast<size_t>(dogY1 - dogY0) * tileWidth * 2);
+    scratch.downscale.resize(static_cast<size_t>(cy1 - cy0) * segmentCells * 4);
+    scratch.haloCells.resize(static_cast<size_t>(segmentCells) * 4);
+    scratch.planes.assign(static_cast<size_t>(cy1 - cy0) * tileCells * 4, 0);
+    scratch.cellEdges.resize(static_cast<size_t>(cy1 - cy0) * tileCells);
+
+    // PS_Luminance + PS_Downscale. Halo rows only need luminance, so their cell
+    // averages go to a throwaway buffer.
+    if (frame.identityTransform) {
+        for (int y = lumY0; y < lumY1;) {
+            bool cellRow = y >= y0 && y < y1;
+            LumaDownscaleArgs args;
+            args.pixels = input.pixels + (static_cast<size_t>(y) * width + sx0) * input.channels;
+            args.pixelStride = static_cast<size_t>(width) * input.channels;
+            args.channels = input.channels;
+            args.width = segmentWidth;
+            args.rows = cellRow ? std::min(8, y1 - y) : 1;
+            args.luminance = &scratch.luminance[static_cast<size_t>(y - lumY0) * segmentWidth];
+            args.luminanceStride = segmentWidth;
+            args.downscale = cellRow ? &scratch.downscale[static_cast<size_t>(y / 8 - cy0) * segmentCells * 4]
+                                     : scratch.haloCells.data();
+            frame.kernels->lumaDownscale(args, 0, segmentCells);
+            y += args.rows;
+        }
+    } else {
+        float rgb[3];
+        for (int y = lumY0; y < lumY1; ++y) {
+            float* row = &scratch.luminance[static_cast<size_t>(y - lumY0) * segmentWidth];
+            for (int x = sx0; x < sx1; ++x) {
+                readSource(input, frame.mapX[x], frame.mapY[y], rgb);
+                row[x - sx0] = asciiLuminance(rgb[0], rgb[1], rgb[2]);
+            }
+        }
+        for (int cy = cy0; cy < cy1; ++cy) {
+            for (int cx = cx0; cx < cx1; ++cx) {
+                float sum[3] = {0.0f, 0.0f, 0.0f};
+                int count = 0;
+                for (int y = cy * 8; y < std::min(cy * 8 + 8, height); ++y) {
+                    for (int x = cx * 8; x < std::min(cx * 8 + 8, width); ++x) {
+                        readSource(input, frame.mapX[x], frame.mapY[y], rgb);
+                        sum[0] += rgb[0];
+                        sum[1] += rgb[1];
+                        sum[2] += rgb[2];
+                        ++count;
+                    }
+                }
+                float* cell = &scratch.downscale[(static_cast<size_t>(cy - cy0) * segmentCells + cx - segmentCell0) * 4];
+                cell[0] = sum[0] / count;
+                cell[1] = sum[1] / count;
+                cell[2] = sum[2] / count;
+                cell[3] = asciiLuminance(cell[0], cell[1], cell[2]);
+            }
+        }
+    }
+
+    // PS_HorizontalBlur. The segment edges clamp like the image edges, but
+    // only where they are the image edges; elsewhere the halo keeps every
+    // column the tile uses at least radius away from them.
+    for (int y = lumY0; y < lumY1; ++y) {
+        size_t row = static_cast<size_t>(y - lumY0) * segmentWidth;
+        frame.kernels->blurRow(&scratch.luminance[row], segmentWidth, taps, radius, &scratch.ping[row * 2]);
+    }
+
+    // PS_VerticalBlurAndDifference
+    const float* pingRows[2 * DogWeights::MAX_RADIUS + 1];
+    for (int y = dogY0; y < dogY1; ++y) {
+        for (int i = -radius; i <= radius; ++i) {
+            pingRows[i + radius] = &scratch.ping[static_cast<size_t>(clampY(y + i) - lumY0) * segmentWidth * 2];
+        }
+        frame.kernels->blurDifferenceRow(pingRows, segmentWidth, taps, radius, params.tau, params.threshold,
+                                         &scratch.dog[static_cast<size_t>(y - dogY0) * segmentWidth]);
+    }
+
+    // PS_EdgeDetect adds nothing without depth: saturate(abs(D - 0)) is the
+    // 0/1 DoG itself, so the Sobel passes read it directly.
+
+    // PS_HorizontalSobel
+    for (int y = dogY0; y < dogY1; ++y) {
+        const float* row = &scratch.dog[static_cast<size_t>(y - dogY0) * segmentWidth];
+        float* out = &scratch.gradient[static_cast<size_t>(y - dogY0) * tileWidth * 2];
+        for (int x = x0; x < x1; ++x) {
+            float lum1 = row[clampX(x - 1) - sx0];
+            float lum2 = row[x - sx0];
+            float lum3 = row[clampX(x + 1) - sx0];
+            out[(x - x0) * 2] = 3.0f * lum1 - 3.0f * lum3;
+            out[(x - x0) * 2 + 1] = 3.0f * lum1 + 10.0f * lum2 + 3.0f * lum3;
+        }
+    }
+
+    // PS_VerticalSobel and the first half of CS_RenderASCII: classify each
+    // pixel and collect direction bit-planes per cell without storing the angles.
+    for (int y = y0; y < y1; ++y) {
+        const float* above = &scratch.gradient[static_cast<size_t>(clampY(y - 1) - dogY0) * tileWidth * 2];
+        const float* centre = &scratch.gradient[static_cast<size_t>(y - dogY0) * tileWidth * 2];
+        const float* below = &scratch.gradient[static_cast<size_t>(clampY(y + 1) - dogY0) * tileWidth * 2];
+        uint64_t* planes = &scratch.planes[static_cast<size_t>(y / 8 - cy0) * tileCells * 4];
+        for (int x = 0; x < tileWidth; ++x) {
+            float gx = 3.0f * above[x * 2] + 10.0f * centre[x * 2] + 3.0f * below[x * 2];
+            float gy = 3.0f * above[x * 2 + 1] - 3.0f * below[x * 2 + 1];
+            if (gx == 0.0f && gy == 0.0f) continue;
+            int direction = asciiEdgeDirection(std::atan2(gy, gx), 1.0f);
+            if (direction >= 0) planes[(x >> 3) * 4 + direction] |= asciiCellBit(x, y);
+        }
+    }
+
+    for (size_t cell = 0; cell < scratch.cellEdges.size(); ++cell) {
+        scratch.cellEdges[cell] = asciiCellVote(&scratch.planes[cell * 4], params.edgeThreshold);
+    }
+
+    // CS_RenderASCII, second half: each cell expanded from its glyph mask
+    // straight into the output, or only recorded when writing text
+    for (int cy = cy0; cy < cy1; ++cy) {
+        const float* infoRow = &scratch.downscale[static_cast<size_t>(cy - cy0) * segmentCells * 4];
+        const int* edgeRow = &scratch.cellEdges[static_cast<size_t>(cy - cy0) * tileCells];
+        if (frame.cellEdges) {
+            size_t cell = static_cast<size_t>(cy) * frame.cellsX + cx0;
+            std::copy(edgeRow, edgeRow + tileCells, frame.cellEdges + cell);
+            std::copy(&infoRow[(cx0 - segmentCell0) * 4], &infoRow[(cx1 - segmentCell0) * 4],
+                      frame.cellDownscale + cell * 4);
+            continue;
+        }
+        for (int cx = cx0; cx < cx1; ++cx) {
+            const float* info = &infoRow[(cx - segmentCell0) * 4];
+            uint64_t glyph = asciiCellGlyph(edgeRow[cx - cx0], info[3], params, *frame.edgesAtlas, *frame.fillAtlas);
+            unsigned char foreground[3], background[3];
+            asciiComposePixel(1.0f, info, 1.0f, params, foreground);
+            asciiComposePixel(0.0f, info, 1.0f, params, background);
+            frame.kernels->expandGlyph(glyph, foreground, background, std::min(8, width - cx * 8),
+                                       std::min(8, height - cy * 8),
+                                       frame.output + (static_cast<size_t>(cy) * 8 * width + cx * 8) * 3,
+                                       static_cast<size_t>(width) * 3);
+        }
+    }
+}
+
+static void runTiles(const CpuImage& input, const AsciiParams& params, const GlyphAtlas* edgesAtlas,
+                     const GlyphAtlas* fillAtlas, ThreadPool& pool, unsigned char* output, int* cellEdges,
+                     float* cellDownscale) {
+    FusedFrame frame;
+    frame.input = &input;
+    frame.params = &params;
+    frame.edgesAtlas = edgesAtlas;
+    frame.fillAtlas = fillAtlas;
+    frame.kernels = &cpuKernels();
+    frame.weights.update(params);
+    frame.identityTransform = params.zoom == 1.0f && params.offset[0] == 0.0f && params.offset[1] == 0.0f;
+    if (!frame.identityTransform) {
+        buildSourceMap(input.width, -params.offset[0], params.zoom, frame.mapX);
+        buildSourceMap(input.height, params.offset[1], params.zoom, frame.mapY);
+    }
+    frame.cellsX = (input.width + 7) / 8;
+    frame.cellsY = (input.height + 7) / 8;
+    frame.tilesX = (frame.cellsX + FUSED_TILE_CELLS - 1) / FUSED_TILE_CELLS;
+    frame.tilesY = (frame.cellsY + FUSED_TILE_CELL_ROWS - 1) / FUSED_TILE_CELL_ROWS;
+    frame.haloCells = (frame.weights.radius + 1 + 7) / 8;
+    frame.output = output;
+    frame.cellEdges = cellEdges;
+    frame.cellDownscale = cellDownscale;
+
+    // Tiles in row-major order, so a band walks along its cell rows.
+    pool.parallelFor(0, frame.tilesY * frame.tilesX, 1, [&](int t0, int t1) {
+        TileScratch scratch;
+        for (int t = t0; t < t1; ++t) {
+            runTile(frame, t / frame.tilesX, t % frame.tilesX, scratch);
+        }
+    });
+}
+
+void runFusedPipeline(const CpuImage& input, const AsciiParams& params, const GlyphAtlas& edgesAtlas,
+                      const GlyphAtlas& fillAtlas, ThreadPool& pool, std::vector<unsigned char>& output) {
+    output.resize(static_cast<size_t>(input.width) * input.height * 3);
+    runTiles(input, params, &edgesAtlas, &fillAtlas, pool, output.data(), nullptr, nullptr);
+}
+
+void runFusedCells(const CpuImage& input, const AsciiParams& params, ThreadPool& pool, std::vector<int>& cellEdges,
+                   std::vector<float>& downscale) {
+    size_t cells = static_cast<size_t>((input.width + 7) / 8) * ((input.height + 7) / 8);
+    cellEdges.resize(cells);
+    downscale.resize(cells * 4);
+    runTiles(input, params, nullptr, nullptr, pool, nullptr, cellEdges.data(), downscale.data());
+}
+
+bool processFrameFused(const CpuImage& input, const char* outputPath, OutputFormat format, const AsciiParams& params,
+                       const GlyphAtlas& edgesAtlas, const GlyphAtlas& fillAtlas, ThreadPool& pool,
+                       ImageWriter& writer) {
+    if (format != OutputFormat::Image) {
+        std::vector<int> cellEdges;
+        std::vector<float> downscale;
+        runFusedCells(input, params, pool, cellEdges, downscale);
+        return writeCellText(outputPath, format, (input.width + 7) / 8, (input.height + 7) / 8, cellEdges.data(),
+                             downscale.data(), params);
+    }
+
+    std::vector<unsigned char> outputData;
+    runFusedPipeline(input, params, edgesAtlas, fillAtlas, pool, outputData);
+
+    writer.write(outputPath, std::move(outputData), input.width, input.height, 3);
+    return true;
+}
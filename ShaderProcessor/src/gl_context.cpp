@@ -0,0 +1,236 @@
+#include "gl_context.h"
+#include <KHR/khrplatform.h>
+#include <glad/glad.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#ifdef ASCII_WITH_GLFW
+#include <GLFW/glfw3.h>
+#endif
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include "texture.h"
+
+// Versions to ask for, best first: compute shaders need 4.3.
+static const int GL_VERSIONS[][2] = {{4, 3}, {3, 3}};
+
+static bool hasExtension(const char* extensions, const char* name) {
+    if (!extensions) return false;
+    size_t length = strlen(name);
+    for (const char* p = strstr(extensions, name); p; p = strstr(p + length, name)) {
+        if ((p == extensions || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0')) return true;
+    }
+    return false;
+}
+
+// Initialises display and makes a core context current on it, without a
+// surface where the display allows that.
+static bool makeCurrentOn(GLContext& context, EGLDisplay display) {
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) return false;
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        eglTerminate(display);
+        return false;
+    }
+
+    bool surfaceless = hasExtension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+    const EGLint configAttribs[] = {
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display, configAttribs, &config, 1, &configCount) || configCount == 0) {
+        eglTerminate(display);
+        return false;
+    }
+
+    EGLContext eglContext = EGL_NO_CONTEXT;
+    for (const int* version : GL_VERSIONS) {
+        const EGLint contextAttribs[] = {
+            EGL_CONTEXT_MAJOR_VERSION, version[0],
+            EGL_CONTEXT_MINOR_VERSION, version[1],
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        eglContext = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+        if (eglContext != EGL_NO_CONTEXT) break;
+    }
+    if (eglContext == EGL_NO_CONTEXT) {
+        eglTerminate(display);
+        return false;
+    }
+
+    EGLSurface surface = EGL_NO_SURFACE;
+    if (!surfaceless) {
+        const EGLint pbufferAttribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+        surface = eglCreatePbufferSurface(display, config, pbufferAttribs);
+    }
+    if ((!surfaceless && surface == EGL_NO_SURFACE) || !eglMakeCurrent(display, surface, surface, eglContext)) {
+        if (surface != EGL_NO_SURFACE) eglDestroySurface(display, surface);
+        eglDestroyContext(display, eglContext);
+        eglTerminate(display);
+        return false;
+    }
+
+    context.eglDisplay = display;
+    context.eglContext = eglContext;
+    context.eglSurface = surface;
+    return true;
+}
+
+bool createHeadlessContext(GLContext& context, int device) {
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+        eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    auto queryDevices = reinterpret_cast<PFNEGLQUERYDEVICESEXTPROC>(eglGetProcAddress("eglQueryDevicesEXT"));
+    auto queryDeviceString = reinterpret_cast<PFNEGLQUERYDEVICESTRINGEXTPROC>(
+        eglGetProcAddress("eglQueryDeviceStringEXT"));
+
+    bool made = false;
+    if (getPlatformDisplay && queryDevices && hasExtension(clientExtensions, "EGL_EXT_platform_device")) {
+        EGLDeviceEXT devices[16];
+        EGLint deviceCount = 0;
+        queryDevices(16, devices, &deviceCount);
+        if (device >= deviceCount) {
+            std::cerr << "EGL device " << device << " not found, " << deviceCount << " available" << std::endl;
+            return false;
+        }
+        for (int i = 0; i < deviceCount && !made; ++i) {
+            if (device >= 0 && i != device) continue;
+            const char* deviceExtensions = queryDeviceString ? queryDeviceString(devices[i], EGL_EXTENSIONS) : nullptr;
+            const char* file = hasExtension(deviceExtensions, "EGL_EXT_device_drm")
+                ? queryDeviceString(devices[i], EGL_DRM_DEVICE_FILE_EXT) : nullptr;
+            bool software = hasExtension(deviceExtensions, "EGL_MESA_device_software");
+            std::cout << "EGL device " << i << ": " << (file ? file : software ? "software" : "unknown") << std::endl;
+            made = makeCurrentOn(context, getPlatformDisplay(EGL_PLATFORM_DEVICE_EXT, devices[i], nullptr));
+        }
+    } else if (device >= 0) {
+        std::cerr << "EGL device enumeration is not supported" << std::endl;
+        return false;
+    }
+    if (!made && device < 0 && getPlatformDisplay && hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+        made = makeCurrentOn(context, getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr));
+    }
+    if (!made && device < 0) {
+        made = makeCurrentOn(context, eglGetDisplay(EGL_DEFAULT_DISPLAY));
+    }
+    if (!made) {
+        std::cerr << "Failed to create an EGL context" << std::endl;
+        return false;
+    }
+
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+        std::cerr << "Failed to initialize GLAD" << std::endl;
+        destroyGLContext(context);
+        return false;
+    }
+    return true;
+}
+
+#ifdef ASCII_WITH_GLFW
+static void errorCallback(int error, const char* description) {
+    fprintf(stderr, "GLFW Error: %s\n", description);
+}
+
+bool createWindowContext(GLContext& context, int width, int height) {
+    if (!glfwInit()) {
+        std::cerr << "Failed to initialize GLFW" << std::endl;
+        return false;
+    }
+
+    glfwSetErrorCallback(errorCallback);
+
+    GLFWwindow* window = nullptr;
+    for (const int* version : GL_VERSIONS) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, version[0]);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, version[1]);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        #ifdef __APPLE__
+            glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        #endif
+        window = glfwCreateWindow(width, height, "ASCII Shader", NULL, NULL);
+        if (window) break;
+    }
+    if (!window) {
+        std::cerr << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return false;
+    }
+
+    glfwMakeContextCurrent(window);
+    context.window = window;
+
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cerr << "Failed to initialize GLAD" << std::endl;
+        destroyGLContext(context);
+        return false;
+    }
+    return true;
+}
+
+void runPreview(GLContext& context, const char* path) {
+    if (!context.window) return;
+    unsigned int texture = loadTexture(path);
+    int width = 0, height = 0;
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+
+    unsigned int fbo;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+
+    while (!glfwWindowShouldClose(context.window)) {
+        // Texel row 0 is the top of the image, so the blit flips it upright.
+        int windowWidth, windowHeight;
+        glfwGetFramebufferSize(context.window, &windowWidth, &windowHeight);
+        glClear(GL_COLOR_BUFFER_BIT);
+        glBlitFramebuffer(0, 0, width, height, 0, windowHeight, windowWidth, 0, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        glfwSwapBuffers(context.window);
+        glfwWaitEvents();
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteTextures(1, &texture);
+}
+#else
+bool createWindowContext(GLContext&, int, int) {
+    std::cerr << "Built without GLFW; the preview window is not available" << std::endl;
+    return false;
+}
+
+void runPreview(GLContext&, const char*) {
+}
+#endif
+
+void destroyGLContext(GLContext& context) {
+#ifdef ASCII_WITH_GLFW
+    if (context.window) {
+        glfwDestroyWindow(context.window);
+        glfwTerminate();
+        context.window = nullptr;
+    }
+#endif
+    if (context.eglDisplay) {
+        EGLDisplay display = context.eglDisplay;
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (context.eglSurface) eglDestroySurface(display, context.eglSurface);
+        eglDestroyContext(display, context.eglContext);
+        eglTerminate(display);
+        context.eglDisplay = context.eglContext = context.eglSurface = nullptr;
+    }
+}
+
+bool hasGLExtension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)));
+        if (extension && strcmp(extension, name) == 0) return true;
+    }
+    return false;
+}
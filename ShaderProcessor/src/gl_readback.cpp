@@ -0,0 +1,100 @@
+#include "gl_readback.h"
+#include <iostream>
+
+void GLReadbackRing::queue(int width, int height, GLReadbackCallback callback) {
+    bindSlot(static_cast<size_t>(width) * height * 4);
+    // RGBA8 matches the render target, so the driver copies without converting.
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    submit(width, height, std::move(callback));
+}
+
+void GLReadbackRing::queueLayers(unsigned int texture, int width, int height, int layers,
+                                 GLReadbackCallback callback) {
+    bindSlot(static_cast<size_t>(width) * height * layers * 4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glGetTexImage(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    submit(width, height * layers, std::move(callback));
+}
+
+// Binds the next buffer, at least bytes long, as the pack buffer.
+void GLReadbackRing::bindSlot(size_t bytes) {
+    poll();
+    // Every buffer is in flight: the oldest frame has had depth - 1 frames
+    // of GPU time to finish, so this rarely waits.
+    if (pending == slots.size()) {
+        finish(slots[oldest]);
+    }
+
+    Slot& slot = slots[next];
+    if (slot.buffer == 0) glGenBuffers(1, &slot.buffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    if (slot.capacity != bytes) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(bytes), nullptr, GL_STREAM_READ);
+        slot.capacity = bytes;
+    }
+}
+
+// Fences the copy just recorded into the bound buffer.
+void GLReadbackRing::submit(int width, int height, GLReadbackCallback callback) {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    Slot& slot = slots[next];
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.width = width;
+    slot.height = height;
+    slot.callback = std::move(callback);
+    // Submit now, so the copy runs while the caller goes on to the next frame.
+    glFlush();
+
+    next = (next + 1) % slots.size();
+    ++pending;
+}
+
+void GLReadbackRing::poll() {
+    while (pending > 0) {
+        GLenum status = glClientWaitSync(slots[oldest].fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+        finish(slots[oldest]);
+    }
+}
+
+void GLReadbackRing::flush() {
+    while (pending > 0) finish(slots[oldest]);
+}
+
+void GLReadbackRing::clear() {
+    flush();
+    for (Slot& slot : slots) {
+        if (slot.buffer != 0) glDeleteBuffers(1, &slot.buffer);
+        slot = Slot();
+    }
+    next = oldest = 0;
+}
+
+// Waits for the oldest frame, maps it and runs its callback.
+void GLReadbackRing::finish(Slot& slot) {
+    const GLuint64 timeout = 1000000000;  // 1 s per wait, repeated until done
+    GLenum status;
+    do {
+        status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+    } while (status == GL_TIMEOUT_EXPIRED);
+    if (status == GL_WAIT_FAILED) std::cerr << "glClientWaitSync failed on a readback fence" << std::endl;
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    const unsigned char* pixels = static_cast<const unsigned char*>(
+        glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(slot.capacity), GL_MAP_READ_BIT));
+    if (pixels) {
+        slot.callback(pixels, slot.width, slot.height);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    } else {
+        std::cerr << "Failed to map readback buffer" << std::endl;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.callback = nullptr;
+
+    oldest = (oldest + 1) % slots.size();
+    --pending;
+}
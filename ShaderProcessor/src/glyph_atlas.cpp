@@ -0,0 +1,42 @@
+#include "glyph_atlas.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <iostream>
+
+uint64_t GlyphAtlas::glyph(int index) const {
+    if (masks.empty()) return 0;
+    return masks[std::min(std::max(index, 0), glyphCount() - 1)];
+}
+
+bool loadGlyphAtlas(const char* path, GlyphAtlas& atlas) {
+    int width, height, channels;
+    unsigned char* data = stbi_load(path, &width, &height, &channels, 0);
+    if (!data) {
+        std::cerr << "Failed to load glyph atlas: " << path << std::endl;
+        return false;
+    }
+    if (width < 8 || height < 8) {
+        std::cerr << "Glyph atlas is smaller than one 8x8 glyph: " << path << std::endl;
+        stbi_image_free(data);
+        return false;
+    }
+
+    // The atlases are black and white; anything brighter than mid grey is ink.
+    atlas.width = width;
+    atlas.height = height;
+    atlas.masks.assign(width / 8, 0);
+    bool oneBit = true;
+    for (int y = 0; y < 8; ++y) {
+        for (int x = 0; x < atlas.glyphCount() * 8; ++x) {
+            unsigned char value = data[(y * width + x) * channels];
+            if (value != 0 && value != 255) oneBit = false;
+            if (value >= 128) atlas.masks[x / 8] |= uint64_t(1) << (y * 8 + (x & 7));
+        }
+    }
+    if (!oneBit) {
+        std::cerr << "Glyph atlas has grey texels, thresholding to one bit: " << path << std::endl;
+    }
+
+    stbi_image_free(data);
+    return true;
+}
@@ -0,0 +1,112 @@
+#include "gpu_resource_pool.h"
+#include "image_processor.h"
+#include <iostream>
+
+size_t glFormatBytes(GLenum internalFormat) {
+    switch (internalFormat) {
+    case GL_R8: return 1;
+    case GL_RG8:
+    case GL_R16F: return 2;
+    case GL_RGBA8:
+    case GL_RG16F:
+    case GL_R32F: return 4;
+    case GL_RGBA16F:
+    case GL_RG32F: return 8;
+    case GL_RGBA32F: return 16;
+    default: return 0;
+    }
+}
+
+unsigned int GLResourcePool::acquireTexture(int width, int height, GLenum internalFormat, GLTextureUsage usage,
+                                            int layers) {
+    ++clock;
+    for (Entry& entry : entries) {
+        if (!entry.inUse && entry.width == width && entry.height == height && entry.layers == layers &&
+            entry.internalFormat == internalFormat && entry.usage == usage) {
+            entry.inUse = true;
+            entry.lastUsed = clock;
+            ++reuses;
+            return entry.texture;
+        }
+    }
+
+    unsigned int texture = layers > 1 ? createTextureArray(width, height, layers, internalFormat)
+                                      : createTexture(width, height, internalFormat);
+    // Account for what the driver was really asked for, not the request.
+    GLint actualFormat = static_cast<GLint>(internalFormat);
+    glGetTexLevelParameteriv(layers > 1 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT,
+                             &actualFormat);
+    size_t bytes = static_cast<size_t>(width) * height * layers * glFormatBytes(static_cast<GLenum>(actualFormat));
+
+    evictIdle(bytes);
+    entries.push_back({texture, width, height, layers, internalFormat, usage, bytes, true, clock});
+    allocated += bytes;
+    ++allocations;
+    return texture;
+}
+
+void GLResourcePool::releaseTexture(unsigned int texture) {
+    for (Entry& entry : entries) {
+        if (entry.texture == texture) {
+            entry.inUse = false;
+            break;
+        }
+    }
+    evictIdle(0);
+}
+
+unsigned int GLResourcePool::framebuffer() {
+    if (fbo == 0) glGenFramebuffers(1, &fbo);
+    return fbo;
+}
+
+void GLResourcePool::setBudget(size_t budgetBytes) {
+    budget = budgetBytes;
+    evictIdle(0);
+}
+
+size_t GLResourcePool::idleBytes() const {
+    size_t bytes = 0;
+    for (const Entry& entry : entries) {
+        if (!entry.inUse) bytes += entry.bytes;
+    }
+    return bytes;
+}
+
+// Deletes idle textures, oldest first, until incomingBytes more fit the budget.
+// Textures in use are never evicted, so the budget can still be exceeded.
+void GLResourcePool::evictIdle(size_t incomingBytes) {
+    if (budget == 0) return;
+    while (allocated + incomingBytes > budget) {
+        size_t oldest = entries.size();
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (!entries[i].inUse && (oldest == entries.size() || entries[i].lastUsed < entries[oldest].lastUsed)) {
+                oldest = i;
+            }
+        }
+        if (oldest == entries.size()) return;
+        deleteEntry(oldest);
+    }
+}
+
+void GLResourcePool::deleteEntry(size_t index) {
+    glDeleteTextures(1, &entries[index].texture);
+    allocated -= entries[index].bytes;
+    entries.erase(entries.begin() + index);
+}
+
+void GLResourcePool::printFootprint() const {
+    const double megabyte = 1024.0 * 1024.0;
+    std::cout << "GPU resource pool: " << entries.size() << " textures, " << allocated / megabyte << " MB ("
+              << idleBytes() / megabyte << " MB idle";
+    if (budget != 0) std::cout << ", budget " << budget / megabyte << " MB";
+    std::cout << "), " << allocations << " allocations, " << reuses << " reuses" << std::endl;
+}
+
+void GLResourcePool::clear() {
+    while (!entries.empty()) deleteEntry(entries.size() - 1);
+    if (fbo != 0) {
+        glDeleteFramebuffers(1, &fbo);
+        fbo = 0;
+    }
+}
@@ -0,0 +1,136 @@
+#include "image_input.h"
+#include "stb_image.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <iostream>
+#include <memory>
+
+DecodedImage::~DecodedImage() {
+    reset();
+}
+
+DecodedImage::DecodedImage(DecodedImage&& other) noexcept {
+    *this = std::move(other);
+}
+
+DecodedImage& DecodedImage::operator=(DecodedImage&& other) noexcept {
+    if (this != &other) {
+        reset();
+        pixels = other.pixels;
+        width = other.width;
+        height = other.height;
+        channels = other.channels;
+        other.pixels = nullptr;
+    }
+    return *this;
+}
+
+void DecodedImage::reset() {
+    if (pixels) stbi_image_free(pixels);
+    pixels = nullptr;
+    width = height = channels = 0;
+}
+
+// A whole file mapped read-only, unmapped with the object.
+struct MappedFile {
+    void* data = MAP_FAILED;
+    size_t size = 0;
+
+    ~MappedFile() {
+        if (data != MAP_FAILED) munmap(data, size);
+    }
+
+    bool map(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0 && info.st_size <= INT_MAX) {
+            size = static_cast<size_t>(info.st_size);
+            data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        close(fd);
+        return data != MAP_FAILED;
+    }
+
+    void advise(int advice) {
+        if (data != MAP_FAILED) madvise(data, size, advice);
+    }
+};
+
+// Decodes from file if it could be mapped, otherwise through stbi_load, which
+// also covers pipes and other files mmap refuses.
+static bool decode(MappedFile& file, const std::string& path, DecodedImage& image, int desiredChannels) {
+    image.reset();
+    int channels = 0;
+    if (file.data != MAP_FAILED) {
+        file.advise(MADV_SEQUENTIAL);
+        image.pixels = stbi_load_from_memory(static_cast<const unsigned char*>(file.data), static_cast<int>(file.size),
+                                             &image.width, &image.height, &channels, desiredChannels);
+    } else {
+        image.pixels = stbi_load(path.c_str(), &image.width, &image.height, &channels, desiredChannels);
+    }
+    if (!image.pixels) {
+        std::cerr << "Failed to load input image: " << path << std::endl;
+        image.reset();
+        return false;
+    }
+    image.channels = desiredChannels ? desiredChannels : channels;
+    return true;
+}
+
+bool loadImage(const std::string& path, DecodedImage& image, int desiredChannels) {
+    MappedFile file;
+    file.map(path);
+    return decode(file, path, image, desiredChannels);
+}
+
+// Starts the kernel reading path into the page cache and returns at once.
+static void prefetch(const std::string& path) {
+    MappedFile file;
+    if (file.map(path)) file.advise(MADV_WILLNEED);
+}
+
+ImageReadAhead::ImageReadAhead(const std::vector<std::string>& paths, int depth, unsigned int threads,
+                               int desiredChannels)
+    : paths(paths), desiredChannels(desiredChannels) {
+    if (depth <= 0 || paths.empty()) return;
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    workerCount = std::min<size_t>(std::min<size_t>(threads, depth), paths.size());
+    ring.reset(new FrameRing<DecodedImage>(depth));
+    for (size_t i = 0; i < workerCount; ++i) workers.emplace_back(&ImageReadAhead::decodeLoop, this);
+}
+
+ImageReadAhead::~ImageReadAhead() {
+    if (ring) ring->close();
+    for (std::thread& worker : workers) worker.join();
+}
+
+void ImageReadAhead::decodeLoop() {
+    for (size_t i; (i = claimed.fetch_add(1)) < paths.size();) {
+        // A file is only decoded once its slot is free, so the images decoded
+        // and not yet taken never outnumber the slots.
+        if (!ring->reserve(i)) return;
+        if (i + workerCount < paths.size()) prefetch(paths[i + workerCount]);
+        DecodedImage image;
+        loadImage(paths[i], image, desiredChannels);
+        if (!ring->put(i, std::move(image))) return;
+    }
+}
+
+bool ImageReadAhead::next(DecodedImage& image) {
+    if (taken == paths.size()) return false;
+    if (!ring) {
+        loadImage(paths[taken++], image, desiredChannels);
+        return true;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    ring->take(taken++, image);
+    waited += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
@@ -1,10 +1,13 @@
 #include "image_processor.h"
+#include "gl_context.h"
+#include "render_graph.h"
 #include <KHR/khrplatform.h>
 #include <glad/glad.h>
+#include <chrono>
 #include <vector>
 #include <iostream>
-#include "stb_image_write.h"
-#include "stb_image.h"
+#include <cstring>
+#include "image_input.h"
 #include <GL/glext.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -30,35 +33,299 @@ void setupQuad() {
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
 }
 
-int getPassIndex(const char* passName) {
-    // Map pass names to indices
-    if (strcmp(passName, "PS_Luminance") == 0) return 0;
-    if (strcmp(passName, "PS_Downscale") == 0) return 1;
-    if (strcmp(passName, "PS_HorizontalBlur") == 0) return 2;
-    if (strcmp(passName, "PS_VerticalBlurAndDifference") == 0) return 3;
-    if (strcmp(passName, "PS_CalculateNormals") == 0) return 4;
-    if (strcmp(passName, "PS_EdgeDetect") == 0) return 5;
-    if (strcmp(passName, "PS_HorizontalSobel") == 0) return 6;
-    if (strcmp(passName, "PS_VerticalSobel") == 0) return 7;
-    if (strcmp(passName, "PS_EndPass") == 0) return 8;
-    return -1; // Invalid pass name
+// Textures the passes read and write, named after their ASCII.fx counterparts.
+// ASCII.fx reuses AFX_AsciiPingTex for the blur and the Sobel partials; here
+// they are separate targets, and the render graph puts them on one texture.
+enum GLTarget {
+    TARGET_SOURCE,     // input image
+    TARGET_DEPTH,      // linearised depth; images carry none
+    TARGET_LUMINANCE,  // AFX_LuminanceAsciiTex
+    TARGET_DOWNSCALE,  // AFX_DownscaleTex, one texel per 8x8 cell
+    TARGET_BLUR,       // AFX_AsciiPingTex as the horizontal blur pair
+    TARGET_DOG,        // AFX_AsciiDogTex
+    TARGET_NORMALS,    // AFXTemp2::AFX_RenderTex2
+    TARGET_EDGES,      // AFX_AsciiEdgesTex
+    TARGET_SOBEL_X,    // AFX_AsciiPingTex as the horizontal Sobel partials
+    TARGET_SOBEL,      // AFX_AsciiSobelTex
+    TARGET_ASCII,      // AFXTemp1::AFX_RenderTex1, written by CS_RenderASCII
+    TARGET_RESULT,     // PS_EndPass copy, read back to the CPU
+    TARGET_CELLS,      // edge vote per cell, read back instead for text output
+    TARGET_COUNT
+};
+
+// Work group size of analysis_compute.glsl.
+const int GL_ANALYSIS_TILE = 16;
+
+struct GLPassInfo {
+    const char* name;          // pixel shader in ASCII.fx
+    const char* fragmentPath;
+    GLTarget target;
+    int scale;                 // target size divisor
+    bool needsDepth;           // skipped when there is no depth texture
+    GLTarget inputs[2];        // bound to texture units 0 and 1
+    const char* samplers[2];
+    int reads[2];              // texels fetched per output texel from each input, -1 for the blur taps
+};
+
+static const GLPassInfo passTable[GL_PASS_COUNT] = {
+    {"PS_Luminance", "../shaders/luminance.glsl", TARGET_LUMINANCE, 1, false,
+     {TARGET_SOURCE, TARGET_COUNT}, {"Source", nullptr}, {1, 0}},
+    {"PS_Downscale", "../shaders/downscale.glsl", TARGET_DOWNSCALE, 8, false,
+     {TARGET_SOURCE, TARGET_COUNT}, {"Source", nullptr}, {64, 0}},
+    {"PS_HorizontalBlur", "../shaders/horizontal_blur.glsl", TARGET_BLUR, 1, false,
+     {TARGET_LUMINANCE, TARGET_COUNT}, {"Luminance", nullptr}, {-1, 0}},
+    {"PS_VerticalBlurAndDifference", "../shaders/vertical_blur_difference.glsl", TARGET_DOG, 1, false,
+     {TARGET_BLUR, TARGET_COUNT}, {"AsciiPing", nullptr}, {-1, 0}},
+    {"PS_CalculateNormals", "../shaders/calculate_normals.glsl", TARGET_NORMALS, 1, true,
+     {TARGET_DEPTH, TARGET_COUNT}, {"Depth", nullptr}, {3, 0}},
+    {"PS_EdgeDetect", "../shaders/edge_detect.glsl", TARGET_EDGES, 1, false,
+     {TARGET_NORMALS, TARGET_DOG}, {"Normals", "DoG"}, {9, 1}},
+    {"PS_HorizontalSobel", "../shaders/horizontal_sobel.glsl", TARGET_SOBEL_X, 1, false,
+     {TARGET_EDGES, TARGET_COUNT}, {"Edges", nullptr}, {3, 0}},
+    {"PS_VerticalSobel", "../shaders/vertical_sobel.glsl", TARGET_SOBEL, 1, false,
+     {TARGET_SOBEL_X, TARGET_DEPTH}, {"AsciiPing", "Depth"}, {3, 1}},
+    {"PS_EndPass", "../shaders/end_pass.glsl", TARGET_RESULT, 1, false,
+     {TARGET_ASCII, TARGET_COUNT}, {"ASCII", nullptr}, {1, 0}},
+};
+
+// Storage of each target. The 0/1 targets and the 8-bit colours are exact
+// in 8 bits; the continuous values are half floats, or 32-bit floats at full
+// precision, which matches the CPU backend bit for bit. The ASCII and cell
+// formats must match the image layouts in ascii_compute.glsl.
+struct GLTargetInfo {
+    const char* name;
+    GLenum halfFormat;
+    GLenum fullFormat;
+    int scale;                 // size divisor
+    GLTextureUsage usage;
+};
+
+static const GLTargetInfo targetTable[TARGET_COUNT] = {
+    {"Source", GL_RGBA8, GL_RGBA8, 1, GLTextureUsage::Upload},
+    {"Depth", GL_R32F, GL_R32F, 1, GLTextureUsage::Upload},
+    {"Luminance", GL_R16F, GL_R32F, 1, GLTextureUsage::RenderTarget},
+    {"Downscale", GL_RGBA16F, GL_RGBA32F, 8, GLTextureUsage::RenderTarget},
+    {"Blur", GL_RG16F, GL_RG32F, 1, GLTextureUsage::RenderTarget},
+    {"DoG", GL_R8, GL_R8, 1, GLTextureUsage::RenderTarget},
+    {"Normals", GL_RGBA16F, GL_RGBA32F, 1, GLTextureUsage::RenderTarget},
+    {"Edges", GL_R8, GL_R8, 1, GLTextureUsage::RenderTarget},
+    {"SobelX", GL_RG16F, GL_RG32F, 1, GLTextureUsage::RenderTarget},
+    {"Sobel", GL_RG16F, GL_RG32F, 1, GLTextureUsage::RenderTarget},       // angle, valid
+    {"ASCII", GL_RGBA8, GL_RGBA8, 1, GLTextureUsage::Storage},
+    {"Result", GL_RGBA8, GL_RGBA8, 1, GLTextureUsage::RenderTarget},
+    {"Cells", GL_R16F, GL_R16F, 8, GLTextureUsage::Storage},             // edge direction, -1 to 3
+};
+
+// One processFrame call: the render graph and what its pass callbacks share.
+struct GLFrame {
+    RenderGraph graph;
+    int targets[TARGET_COUNT];  // graph texture of each target, -1 where the frame has none
+    GLPipeline* pipeline;
+    unsigned int fbo;
+    int width;
+    int height;
+    int layers = 1;             // frames of a batch, one per array layer
+};
+
+// Sampler units never change, so they are set once here rather than per
+// draw, and every program's AsciiParams block is pointed at the one buffer.
+static void bindProgram(Shader& shader, const char* sampler0, const char* sampler1) {
+    shader.use();
+    shader.bindUniformBlock("AsciiParams", GL_PARAMS_BINDING);
+    int blockSize = shader.uniformBlockSize("AsciiParams");
+    if (blockSize >= 0 && blockSize != static_cast<int>(sizeof(GLParamsBlock))) {
+        std::cerr << "AsciiParams block is " << blockSize << " bytes, expected " << sizeof(GLParamsBlock)
+                  << std::endl;
+    }
+    if (sampler0) shader.setInt(sampler0, 0);
+    if (sampler1) shader.setInt(sampler1, 1);
 }
 
-void renderPass(Shader& shader, const char* passName) {
+void createGLPipeline(GLPipeline& pipeline, bool useCompute) {
+    for (int i = 0; i < GL_PASS_COUNT; ++i) {
+        pipeline.passes[i] = new Shader("../shaders/vertex.glsl", passTable[i].fragmentPath);
+    }
+    if (useCompute) {
+        // The ballot vote where the driver has subgroup ballots; the
+        // shared-memory vote otherwise, or if the ballot program fails to link.
+        // llvmpipe exposes ballots but runs them slower than its shared-memory
+        // atomics, so there they are only used when asked for.
+        const char* renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+        bool softwareRenderer = renderer && std::strstr(renderer, "llvmpipe");
+        pipeline.subgroupVote = (pipeline.subgroupMode > 0 || (pipeline.subgroupMode < 0 && !softwareRenderer)) &&
+                                hasGLExtension("GL_ARB_shader_ballot") && hasGLExtension("GL_ARB_gpu_shader_int64");
+        if (pipeline.subgroupVote) {
+            pipeline.computeShader = new Shader("../shaders/ascii_compute_ballot.glsl");
+            GLint linked = GL_FALSE;
+            glGetProgramiv(pipeline.computeShader->ID, GL_LINK_STATUS, &linked);
+            if (linked != GL_TRUE) {
+                delete pipeline.computeShader;
+                pipeline.subgroupVote = false;
+            }
+        }
+        const char* asciiPath = pipeline.subgroupVote ? "../shaders/ascii_compute_ballot.glsl"
+                                                       : "../shaders/ascii_compute.glsl";
+        if (!pipeline.subgroupVote) pipeline.computeShader = new Shader(asciiPath);
+        std::cout << "CS_RenderASCII vote: " << (pipeline.subgroupVote ? "subgroup ballots" : "shared memory")
+                  << std::endl;
+        pipeline.analysisShader = new Shader("../shaders/analysis_compute.glsl");
+
+        // The same sources over texture arrays. PS_Downscale becomes a compute
+        // pass too, writing the Downscale format of the chosen precision.
+        if (pipeline.batchSize > 1) {
+            const std::string batch = "#define ASCII_BATCH\n";
+            pipeline.batchAnalysis = Shader::compute("../shaders/analysis_compute.glsl", batch);
+            pipeline.batchCompute = Shader::compute(asciiPath, batch);
+            pipeline.batchDownscale = Shader::compute(
+                "../shaders/downscale_compute.glsl",
+                pipeline.precision == GLPrecision::Full ? "#define DOWNSCALE_FORMAT rgba32f\n"
+                                                        : "#define DOWNSCALE_FORMAT rgba16f\n");
+        }
+    } else {
+        pipeline.fallbackShader = new Shader("../shaders/vertex.glsl", "../shaders/ascii_fallback.glsl");
+    }
+
+    glGenBuffers(1, &pipeline.paramsBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, pipeline.paramsBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(GLParamsBlock), nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, GL_PARAMS_BINDING, pipeline.paramsBuffer);
+    pipeline.paramsUploaded = false;
+
+    for (int i = 0; i < GL_PASS_COUNT; ++i) {
+        bindProgram(*pipeline.passes[i], passTable[i].samplers[0], passTable[i].samplers[1]);
+    }
+    bindProgram(useCompute ? *pipeline.computeShader : *pipeline.fallbackShader, "Sobel", "Downscale");
+    if (pipeline.analysisShader) bindProgram(*pipeline.analysisShader, "Source", nullptr);
+    if (pipeline.batchCompute) {
+        bindProgram(*pipeline.batchDownscale, "Source", nullptr);
+        bindProgram(*pipeline.batchAnalysis, "Source", nullptr);
+        bindProgram(*pipeline.batchCompute, "Sobel", "Downscale");
+    }
+}
+
+void destroyGLPipeline(GLPipeline& pipeline) {
+    for (int i = 0; i < GL_PASS_COUNT; ++i) {
+        delete pipeline.passes[i];
+        pipeline.passes[i] = nullptr;
+    }
+    delete pipeline.computeShader;
+    delete pipeline.fallbackShader;
+    delete pipeline.analysisShader;
+    delete pipeline.batchDownscale;
+    delete pipeline.batchAnalysis;
+    delete pipeline.batchCompute;
+    pipeline.computeShader = nullptr;
+    pipeline.fallbackShader = nullptr;
+    pipeline.analysisShader = nullptr;
+    pipeline.batchDownscale = pipeline.batchAnalysis = pipeline.batchCompute = nullptr;
+
+    if (pipeline.paramsBuffer != 0) {
+        glDeleteBuffers(1, &pipeline.paramsBuffer);
+        pipeline.paramsBuffer = 0;
+    }
+
+    pipeline.readback.clear();
+    pipeline.writer->flush();
+    pipeline.resources.printFootprint();
+    pipeline.resources.clear();
+    if (quadVAO != 0) {
+        glDeleteVertexArrays(1, &quadVAO);
+        glDeleteBuffers(1, &quadVBO);
+        quadVAO = quadVBO = 0;
+    }
+}
+
+static void renderPass(GLPass pass, const GLFrame& frame) {
+    const GLPassInfo& info = passTable[pass];
+    Shader& shader = *frame.pipeline->passes[pass];
     shader.use();
-    shader.setInt("pass", getPassIndex(passName));
+    for (int i = 0; i < 2; ++i) {
+        if (info.inputs[i] == TARGET_COUNT || frame.targets[info.inputs[i]] < 0) continue;
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, frame.graph.texture(frame.targets[info.inputs[i]]));
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, frame.fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                           frame.graph.texture(frame.targets[info.target]), 0);
+    glViewport(0, 0, (frame.width + info.scale - 1) / info.scale, (frame.height + info.scale - 1) / info.scale);
     glBindVertexArray(quadVAO);
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 }
 
+// Declares a fragment pass to the graph from its passTable entry. Inputs the
+// frame does not have, such as depth for images, are left out, and a pass
+// that needs depth is not added at all.
+static void addFragmentPass(GLFrame& frame, GLPass pass, int blurTaps) {
+    const GLPassInfo& info = passTable[pass];
+    if (info.needsDepth && frame.targets[TARGET_DEPTH] < 0) return;
+    int node = frame.graph.addPass(info.name, [&frame, pass] { renderPass(pass, frame); });
+    for (int i = 0; i < 2; ++i) {
+        if (info.inputs[i] == TARGET_COUNT || frame.targets[info.inputs[i]] < 0) continue;
+        frame.graph.read(node, frame.targets[info.inputs[i]], info.reads[i] < 0 ? blurTaps : info.reads[i]);
+    }
+    frame.graph.write(node, frame.targets[info.target]);
+}
+
+bool flushGLReadbacks(GLPipeline& pipeline) {
+    pipeline.readback.flush();
+    return pipeline.writer->flush();
+}
+
+void updateBlurWeights(GLPipeline& pipeline, const AsciiParams& params) {
+    if (!pipeline.dogWeights.update(params)) return;
+
+    const DogWeights& weights = pipeline.dogWeights;
+    Shader* programs[] = {pipeline.passes[PASS_HORIZONTAL_BLUR], pipeline.passes[PASS_VERTICAL_BLUR],
+                          pipeline.analysisShader, pipeline.batchAnalysis};
+    for (Shader* program : programs) {
+        if (!program) continue;
+        program->use();
+        program->setInt("_KernelSize", weights.radius);
+        program->setVec2Array("_BlurWeights", weights.taps.data(), weights.tapCount());
+    }
+}
+
+// Pixel transfer format and type glTexImage2D needs for a sized format.
+static void uploadFormat(GLenum internalFormat, GLenum& format, GLenum& type) {
+    switch (internalFormat) {
+    case GL_R8: format = GL_RED; type = GL_UNSIGNED_BYTE; break;
+    case GL_RGBA8: format = GL_RGBA; type = GL_UNSIGNED_BYTE; break;
+    case GL_R16F:
+    case GL_R32F: format = GL_RED; type = GL_FLOAT; break;
+    case GL_RG16F:
+    case GL_RG32F: format = GL_RG; type = GL_FLOAT; break;
+    default: format = GL_RGBA; type = GL_FLOAT; break;
+    }
+}
+
 unsigned int createTexture(int width, int height, GLenum internalFormat) {
     unsigned int texture;
     glGenTextures(1, &texture);
     glBindTexture(GL_TEXTURE_2D, texture);
-    // glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, GL_RED, GL_FLOAT, NULL);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+    if (GLAD_GL_VERSION_4_2) {
+        // Immutable storage: one level, never respecified, so the driver
+        // can settle the layout once.
+        glTexStorage2D(GL_TEXTURE_2D, 1, internalFormat, width, height);
+    } else {
+        GLenum format, type;
+        uploadFormat(internalFormat, format, type);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+    }
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    return texture;
+}
+
+unsigned int createTextureArray(int width, int height, int layers, GLenum internalFormat) {
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, internalFormat, width, height, layers);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
     return texture;
 }
 
@@ -96,334 +363,395 @@ void createOutputDirectory(const std::string& path) {
     }
 }
 
-// void processImage(const char* inputPath, const char* outputPath, Shader& shader) {
-// void processImage(const char* inputPath, const char* outputPath, Shader& shader, Shader& computeShader) {
-// void processImage(const char* inputPath, const char* outputPath, Shader& shader, Shader& computeShader, unsigned int edgesASCIITexture, unsigned int fillASCIITexture) {
-void processImage(const char* inputPath, const char* outputPath, Shader& shader, unsigned int edgesASCIITexture, unsigned int fillASCIITexture, Shader* computeShader) {
-    // Load input image
-    int width, height, channels;
-    unsigned char* inputData = stbi_load(inputPath, &width, &height, &channels, 0);
-    if (!inputData) {
-        std::cerr << "Failed to load input image" << std::endl;
-        return;
+// The decoded image as-is, into a pooled RGBA8 texture: the first passes
+// texelFetch it, so no filtering or mipmaps.
+static void uploadSourceTexture(unsigned int texture, const unsigned char* pixels, int width, int height,
+                                int channels) {
+    static const GLenum formats[] = {GL_RED, GL_RG, GL_RGB, GL_RGBA};
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, formats[channels - 1], GL_UNSIGNED_BYTE, pixels);
+    // Greyscale reads as grey in every channel, as on the CPU backend. Set
+    // every time, since the texture may have held a colour image before.
+    GLint swizzle[] = {GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA};
+    if (channels < 3) {
+        swizzle[1] = swizzle[2] = GL_RED;
+        swizzle[3] = channels == 2 ? GL_GREEN : GL_ONE;
+    } else if (channels == 3) {
+        swizzle[3] = GL_ONE;
     }
-
-    // checkOutputDirectory("../output/");
-    createOutputDirectory("../output/");
-
-    // Create framebuffer
-   // Create framebuffer
-unsigned int fbo;
-glGenFramebuffers(1, &fbo);
-glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-
-// Create and attach a color attachment texture
-unsigned int colorAttachment;
-glGenTextures(1, &colorAttachment);
-glBindTexture(GL_TEXTURE_2D, colorAttachment);
-glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorAttachment, 0);
-
-// Check framebuffer completeness
-if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-    std::cerr << "Framebuffer is not complete!" << std::endl;
-    return;
-}
-std::cout << "Framebuffer created successfully." << std::endl;
-
-    // Create textures for each pass
-unsigned int luminanceTexture = createTexture(width, height, GL_R16F);
-if (luminanceTexture == 0) {
-    std::cerr << "Failed to create luminance texture" << std::endl;
-    return;
-}
-
-unsigned int downscaleTexture = createTexture(width / 8, height / 8, GL_RGBA16F);
-if (downscaleTexture == 0) {
-    std::cerr << "Failed to create downscale texture" << std::endl;
-    return;
+    glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
 }
 
-unsigned int asciiPingTexture = createTexture(width, height, GL_RGBA16F);
-if (asciiPingTexture == 0) {
-    std::cerr << "Failed to create ASCII ping texture" << std::endl;
-    return;
-}
-
-unsigned int asciiDogTexture = createTexture(width, height, GL_R16F);
-if (asciiDogTexture == 0) {
-    std::cerr << "Failed to create ASCII DoG texture" << std::endl;
-    return;
-}
-
-unsigned int normalsTexture = createTexture(width, height, GL_RGBA16F);
-if (normalsTexture == 0) {
-    std::cerr << "Failed to create normals texture" << std::endl;
-    return;
-}
-
-unsigned int asciiEdgesTexture = createTexture(width, height, GL_R16F);
-if (asciiEdgesTexture == 0) {
-    std::cerr << "Failed to create ASCII edges texture" << std::endl;
-    return;
+// Sizes of the _EdgesGlyphs and _FillGlyphs arrays in the ASCII programs.
+const int GL_EDGE_GLYPHS = 5;
+const int GL_FILL_GLYPHS = 10;
+
+// An atlas as (low, high) 32-bit halves of each glyph mask. Missing glyphs
+// repeat the last one, as the clamping sampler did.
+static void packGlyphs(uint32_t (*slots)[4], const GlyphAtlas& atlas, int count) {
+    for (int i = 0; i < count; ++i) {
+        uint64_t glyph = atlas.glyph(i);
+        slots[i][0] = static_cast<uint32_t>(glyph);
+        slots[i][1] = static_cast<uint32_t>(glyph >> 32);
+    }
 }
 
-unsigned int asciiSobelTexture = createTexture(width, height, GL_RG16F);
-if (asciiSobelTexture == 0) {
-    std::cerr << "Failed to create ASCII Sobel texture" << std::endl;
-    return;
+// Without a depth texture the depth and normal terms drop out, as they do on
+// the CPU backend.
+void updateParamsBlock(GLPipeline& pipeline, const AsciiParams& params, bool hasDepth) {
+    GLParamsBlock block = {};
+    for (int i = 0; i < 3; ++i) {
+        block.asciiColor[i] = params.asciiColor[i];
+        block.backgroundColor[i] = params.backgroundColor[i];
+    }
+    block.blendWithBase = params.blendWithBase;
+    block.exposure = params.exposure;
+    block.offset[0] = params.offset[0];
+    block.offset[1] = params.offset[1];
+    block.zoom = params.zoom;
+    block.attenuation = params.attenuation;
+    block.tau = params.tau;
+    block.threshold = params.threshold;
+    block.depthThreshold = params.depthThreshold;
+    block.normalThreshold = params.normalThreshold;
+    block.depthCutoff = hasDepth ? params.depthCutoff : 0.0f;
+    block.depthFalloff = params.depthFalloff;
+    block.depthOffset = params.depthOffset;
+    block.edgeThreshold = params.edgeThreshold;
+    block.edges = params.edges;
+    block.fill = params.fill;
+    block.invertLuminance = params.invertLuminance;
+    block.useDepth = hasDepth && params.useDepth;
+    block.useNormals = hasDepth && params.useNormals;
+    packGlyphs(block.edgesGlyphs, pipeline.edgesAtlas, GL_EDGE_GLYPHS);
+    packGlyphs(block.fillGlyphs, pipeline.fillAtlas, GL_FILL_GLYPHS);
+
+    if (pipeline.paramsUploaded && std::memcmp(&block, &pipeline.paramsBlock, sizeof(block)) == 0) return;
+    pipeline.paramsBlock = block;
+    pipeline.paramsUploaded = true;
+    glBindBuffer(GL_UNIFORM_BUFFER, pipeline.paramsBuffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(block), &block);
 }
 
-// Create texture to render to
-unsigned int outputTexture;
-glGenTextures(1, &outputTexture);
-glBindTexture(GL_TEXTURE_2D, outputTexture);
-glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-if (glGetError() != GL_NO_ERROR) {
-    std::cerr << "Failed to create output texture" << std::endl;
-    checkOpenGLError("glTexImage2D for outputTexture");
-    return;
+// Times glyphBenchmarkRuns more dispatches of CS_RenderASCII with the
+// bindings of the one just run. Wall clock between glFinish calls, since
+// software drivers run compute outside any timer query.
+static void benchmarkGlyphPass(const GLPipeline& pipeline, int width, int height) {
+    if (pipeline.glyphBenchmarkRuns <= 0) return;
+    glFinish();
+    auto start = std::chrono::steady_clock::now();
+    for (int run = 0; run < pipeline.glyphBenchmarkRuns; ++run) {
+        glDispatchCompute((width + 7) / 8, (height + 7) / 8, 1);
+    }
+    glFinish();
+    double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "CS_RenderASCII (" << (pipeline.subgroupVote ? "subgroup ballots" : "shared memory") << "): "
+              << elapsed / pipeline.glyphBenchmarkRuns << " ms per dispatch over " << pipeline.glyphBenchmarkRuns
+              << " runs" << std::endl;
 }
 
-    // Use the passed edgesASCIITexture and fillASCIITexture
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, edgesASCIITexture);
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_2D, fillASCIITexture);
+bool processFrame(const unsigned char* inputData, int width, int height, int channels, const char* outputPath,
+                  OutputFormat format, GLPipeline& pipeline, const AsciiParams& params) {
+    // Text output needs CS_RenderASCII's per-cell vote; the fallback classifies per pixel.
+    const bool text = format != OutputFormat::Image;
+    if (text && !pipeline.computeShader) {
+        std::cerr << "Text output needs compute shaders (OpenGL 4.3); use --backend cpu" << std::endl;
+        return false;
+    }
 
-    // Set the uniforms for these textures in the shader
-    shader.use();
-    shader.setInt("EdgesASCII", 2);
-    shader.setInt("FillASCII", 3);
+    if (quadVAO == 0) setupQuad();
+    updateBlurWeights(pipeline, params);
+    updateParamsBlock(pipeline, params, false);
+
+    // The frame as a render graph. Images have no depth, so the normals pass
+    // is never declared. From GL 4.3 the passes from luminance to Sobel run
+    // as one compute dispatch unless fragment passes were asked for; then
+    // luminance, blur, DoG and edges only exist in shared memory and the
+    // Sobel target takes the rg32f of analysis_compute.glsl. The source is
+    // uploaded into a pooled texture and imported.
+    const bool computeAnalysis = pipeline.analysisShader && !pipeline.fragmentAnalysis;
+    const int blurTaps = pipeline.dogWeights.tapCount();
+    GLResourcePool& pool = pipeline.resources;
+    unsigned int source = pool.acquireTexture(width, height, GL_RGBA8, GLTextureUsage::Upload);
+    uploadSourceTexture(source, inputData, width, height, channels);
+    checkOpenGLError("acquireTexture");
+
+    GLFrame frame;
+    frame.pipeline = &pipeline;
+    frame.fbo = pool.framebuffer();
+    frame.width = width;
+    frame.height = height;
+    RenderGraph& graph = frame.graph;
+    for (int target = 0; target < TARGET_COUNT; ++target) {
+        const GLTargetInfo& info = targetTable[target];
+        frame.targets[target] = -1;
+        if (target == TARGET_SOURCE) {
+            frame.targets[target] = graph.importTexture(info.name, source, width, height, GL_RGBA8);
+        } else if (target != TARGET_DEPTH && target != TARGET_NORMALS) {
+            GLenum format = pipeline.precision == GLPrecision::Full ? info.fullFormat : info.halfFormat;
+            if (target == TARGET_SOBEL && computeAnalysis) format = GL_RG32F;
+            frame.targets[target] = graph.createTexture(info.name, (width + info.scale - 1) / info.scale,
+                                                        (height + info.scale - 1) / info.scale, format, info.usage);
+        }
+    }
 
-    // Create texture to render to
-    // unsigned int outputTexture;
-    // glGenTextures(1, &outputTexture);
-    // glBindTexture(GL_TEXTURE_2D, outputTexture);
-    // glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-    // glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, outputTexture, 0);
+    if (computeAnalysis) {
+        addFragmentPass(frame, PASS_DOWNSCALE, blurTaps);
+        int analysis = graph.addPass("CS_Analysis", [&frame] {
+            const RenderGraph& graph = frame.graph;
+            int sobel = frame.targets[TARGET_SOBEL];
+            frame.pipeline->analysisShader->use();
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, graph.texture(frame.targets[TARGET_SOURCE]));
+            glBindImageTexture(0, graph.texture(sobel), 0, GL_FALSE, 0, GL_WRITE_ONLY, graph.format(sobel));
+            glDispatchCompute((frame.width + GL_ANALYSIS_TILE - 1) / GL_ANALYSIS_TILE,
+                              (frame.height + GL_ANALYSIS_TILE - 1) / GL_ANALYSIS_TILE, 1);
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+        });
+        // One source fetch per pixel of each tile and its halo.
+        int span = GL_ANALYSIS_TILE + 2 * ((blurTaps - 1) / 2 + 1);
+        graph.read(analysis, frame.targets[TARGET_SOURCE],
+                   static_cast<double>(span * span) / (GL_ANALYSIS_TILE * GL_ANALYSIS_TILE));
+        graph.write(analysis, frame.targets[TARGET_SOBEL]);
+    } else {
+        for (int pass = PASS_LUMINANCE; pass <= PASS_VERTICAL_SOBEL; ++pass) {
+            addFragmentPass(frame, static_cast<GLPass>(pass), blurTaps);
+        }
+    }
 
+    // CS_RenderASCII, or its fragment fallback below GL 4.3. For text only
+    // the vote runs; the glyphs are never composited. Without edge glyphs
+    // the vote is skipped, so the Sobel, and with it every analysis pass,
+    // is culled.
+    const int asciiTarget = text ? TARGET_CELLS : TARGET_ASCII;
+    int ascii = graph.addPass(pipeline.computeShader ? "CS_RenderASCII" : "CS_RenderASCII (fragment)",
+                              [&frame, text, asciiTarget] {
+        const RenderGraph& graph = frame.graph;
+        const GLPipeline& pipeline = *frame.pipeline;
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, graph.texture(frame.targets[TARGET_SOBEL]));
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, graph.texture(frame.targets[TARGET_DOWNSCALE]));
+
+        unsigned int output = graph.texture(frame.targets[asciiTarget]);
+        if (pipeline.computeShader) {
+            pipeline.computeShader->use();
+            pipeline.computeShader->setBool("_CellsOnly", text);
+            pipeline.computeShader->setIVec2("_ImageSize", frame.width, frame.height);
+            glBindImageTexture(text ? 1 : 0, output, 0, GL_FALSE, 0, GL_WRITE_ONLY,
+                               graph.format(frame.targets[asciiTarget]));
+            glDispatchCompute((frame.width + 7) / 8, (frame.height + 7) / 8, 1);
+            benchmarkGlyphPass(pipeline, frame.width, frame.height);
+            glMemoryBarrier(text ? GL_TEXTURE_UPDATE_BARRIER_BIT : GL_TEXTURE_FETCH_BARRIER_BIT);
+        } else {
+            pipeline.fallbackShader->use();
+            glBindFramebuffer(GL_FRAMEBUFFER, frame.fbo);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, output, 0);
+            glViewport(0, 0, frame.width, frame.height);
+            glBindVertexArray(quadVAO);
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        }
+    });
+    if (params.edges) graph.read(ascii, frame.targets[TARGET_SOBEL], text ? 64 : 1);
+    if (!text) graph.read(ascii, frame.targets[TARGET_DOWNSCALE]);
+    graph.write(ascii, frame.targets[asciiTarget]);
+
+    bool written = true;
+    if (text) {
+        // Read back the two cell-sized textures only: 1/64 of the pixels.
+        int readback = graph.addPass("Readback", [&frame, outputPath, format, &params, &written] {
+            int cellsX = (frame.width + 7) / 8;
+            int cellsY = (frame.height + 7) / 8;
+            std::vector<float> cells(static_cast<size_t>(cellsX) * cellsY * 4);
+            std::vector<float> downscale(cells.size());
+            glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            glBindTexture(GL_TEXTURE_2D, frame.graph.texture(frame.targets[TARGET_CELLS]));
+            glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, cells.data());
+            glBindTexture(GL_TEXTURE_2D, frame.graph.texture(frame.targets[TARGET_DOWNSCALE]));
+            glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, downscale.data());
+            checkOpenGLError("glGetTexImage");
+
+            std::vector<int> cellEdges(static_cast<size_t>(cellsX) * cellsY);
+            for (size_t i = 0; i < cellEdges.size(); ++i) cellEdges[i] = static_cast<int>(cells[i * 4]);
+            written = writeCellText(outputPath, format, cellsX, cellsY, cellEdges.data(), downscale.data(), params);
+        }, true);
+        graph.read(readback, frame.targets[TARGET_CELLS]);
+        graph.read(readback, frame.targets[TARGET_DOWNSCALE]);
+    } else {
+        addFragmentPass(frame, PASS_END, blurTaps);
+        // Queue the read; the image is written once the GPU is done with this
+        // frame, from a later processFrame call or flushGLReadbacks. Texel
+        // row 0 holds the top image row, so no flip is needed.
+        int readback = graph.addPass("Readback", [&frame, outputPath] {
+            glBindFramebuffer(GL_FRAMEBUFFER, frame.fbo);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                                   frame.graph.texture(frame.targets[TARGET_RESULT]), 0);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+                std::cerr << "Framebuffer is not complete!" << std::endl;
+            }
+
+            std::string path = outputPath;
+            ImageWriter* writer = frame.pipeline->writer;
+            frame.pipeline->readback.queue(frame.width, frame.height,
+                                           [path, writer](const unsigned char* rgba, int w, int h) {
+                writer->write(path, rgba, w, h, 4);
+            });
+            checkOpenGLError("glReadPixels");
+        }, true);
+        graph.read(readback, frame.targets[TARGET_RESULT]);
+    }
 
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-        std::cerr << "Framebuffer is not complete!" << std::endl;
-        return;
+    graph.compile();
+    if (width != pipeline.plannedWidth || height != pipeline.plannedHeight || pipeline.plannedLayers != 1) {
+        std::cout << "Render graph for " << width << "x" << height << ":" << std::endl;
+        graph.printPlan();
+        pipeline.plannedWidth = width;
+        pipeline.plannedHeight = height;
+        pipeline.plannedLayers = 1;
     }
-     // Render passes
-    // Pass 1: Luminance
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, luminanceTexture, 0);
-    renderPass(shader, "PS_Luminance");
-
-    // Pass 2: Downscale
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, downscaleTexture, 0);
-    renderPass(shader, "PS_Downscale");
-
-    // Pass 3: Horizontal Blur
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, asciiPingTexture, 0);
-    renderPass(shader, "PS_HorizontalBlur");
-
-    // Pass 4: Vertical Blur and Difference
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, asciiDogTexture, 0);
-    renderPass(shader, "PS_VerticalBlurAndDifference");
-
-    // Pass 5: Calculate Normals
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, normalsTexture, 0);
-    renderPass(shader, "PS_CalculateNormals");
-
-    // Pass 6: Edge Detect
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, asciiEdgesTexture, 0);
-    renderPass(shader, "PS_EdgeDetect");
-
-    // Pass 7: Horizontal Sobel
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, asciiPingTexture, 0);
-    renderPass(shader, "PS_HorizontalSobel");
-
-    // Pass 8: Vertical Sobel
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, asciiSobelTexture, 0);
-    renderPass(shader, "PS_VerticalSobel");
-
-    // Specify draw buffers
-    GLenum drawBuffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3, GL_COLOR_ATTACHMENT4, GL_COLOR_ATTACHMENT5, GL_COLOR_ATTACHMENT6};
-    glDrawBuffers(7, drawBuffers);
-
-    // // Check framebuffer completeness
-    // if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-    //     std::cout << "Framebuffer is not complete!" << std::endl;
-    // }
-
-    // Pass 9: Render ASCII (This will be a compute shader pass, we'll handle it separately)
-    if (computeShader) {
-    // Compute shader pass
-    computeShader->use();
-
-    // Bind input textures
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, asciiSobelTexture);
-    computeShader->setInt("Sobel", 0);
-
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, downscaleTexture);
-    computeShader->setInt("Downscale", 1);
-
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, edgesASCIITexture);
-    computeShader->setInt("EdgesASCII", 2);
-
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_2D, fillASCIITexture);
-    computeShader->setInt("FillASCII", 3);
-
-    // Set uniforms
-    computeShader->setInt("_EdgeThreshold", 8);
-    computeShader->setBool("_Edges", true);
-    computeShader->setBool("_Fill", true);
-    computeShader->setFloat("_Exposure", 1.0f);
-    computeShader->setFloat("_Attenuation", 1.0f);
-    computeShader->setBool("_InvertLuminance", false);
-    computeShader->setVec3("_ASCIIColor", 1.0f, 1.0f, 1.0f);
-    computeShader->setVec3("_BackgroundColor", 0.0f, 0.0f, 0.0f);
-    computeShader->setFloat("_BlendWithBase", 0.0f);
-
-    // Bind image textures
-    glBindImageTexture(0, asciiSobelTexture, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RG32F);
-    glBindImageTexture(1, outputTexture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32F);
-
-    // Dispatch compute shader
-    glDispatchCompute((width + 7) / 8, (height + 7) / 8, 1);
-    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
-} else {
-    // Fallback fragment shader pass
-    shader.use();
+    graph.execute(pool);
 
-    // Bind input textures
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, asciiSobelTexture);
-    shader.setInt("Sobel", 0);
-
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, downscaleTexture);
-    shader.setInt("Downscale", 1);
-
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, edgesASCIITexture);
-    shader.setInt("EdgesASCII", 2);
-
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_2D, fillASCIITexture);
-    shader.setInt("FillASCII", 3);
-
-    // Set uniforms
-    shader.setInt("_EdgeThreshold", 8);
-    shader.setBool("_Edges", true);
-    shader.setBool("_Fill", true);
-    shader.setFloat("_Exposure", 1.0f);
-    shader.setFloat("_Attenuation", 1.0f);
-    shader.setBool("_InvertLuminance", false);
-    shader.setVec3("_ASCIIColor", 1.0f, 1.0f, 1.0f);
-    shader.setVec3("_BackgroundColor", 0.0f, 0.0f, 0.0f);
-    shader.setFloat("_BlendWithBase", 0.0f);
-
-    // Render to output texture
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, outputTexture, 0);
-    glViewport(0, 0, width, height);
-    
-    // Draw fullscreen quad
-    glBindVertexArray(quadVAO);
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    glBindVertexArray(0);
+    // The graph has handed its textures back to the pool. The attachment is
+    // dropped so an evicted texture is not kept alive by the framebuffer.
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    pool.releaseTexture(source);
+    return written;
 }
 
-    // Final Pass
-    // glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, outputTexture, 0);
-    // renderPass(shader, "PS_EndPass");
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glViewport(0, 0, width, height);
-    shader.use();
-    shader.setInt("pass", getPassIndex("PS_EndPass"));
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, outputTexture);
-    // renderPass(shader, "PS_EndPass");   
-    std::cout << "Starting final render pass..." << std::endl;
-    renderPass(shader, "PS_EndPass");
-    std::cout << "Final render pass completed." << std::endl;
-
-    // Read pixels
-    std::vector<unsigned char> outputData(width * height * 3);
-    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, outputData.data()); 
-    if (!inputData) {
-        std::cerr << "Failed to load input image: " << inputPath << std::endl;
-        return;
+int processBatch(const DecodedImage* images, const std::string* outputPaths, int count, GLPipeline& pipeline,
+                 const AsciiParams& params, bool& rendered) {
+    rendered = true;
+    if (count > pipeline.batchSize) count = pipeline.batchSize;
+    const bool batched = pipeline.batchCompute && !pipeline.fragmentAnalysis;
+
+    const int width = images[0].width;
+    const int height = images[0].height;
+    int layers = 0;
+    while (batched && layers < count && images[layers].pixels && images[layers].channels == 4 &&
+           images[layers].width == width && images[layers].height == height) {
+        ++layers;
     }
-    std::cout << "Input image loaded successfully." << std::endl;
-
-    // Save output image
-    std::cout << "Attempting to write output image to: " << outputPath << std::endl;
-    std::cout << "Image dimensions: " << width << "x" << height << std::endl;
-    std::cout << "Output data size: " << outputData.size() << std::endl;
-    stbi_flip_vertically_on_write(true);
-    stbi_write_png(outputPath, width, height, 3, outputData.data(), width * 3);
-    if (!stbi_write_png(outputPath, width, height, 3, outputData.data(), width * 3)) {
-        std::cerr << "Failed to write output image: " << outputPath << std::endl;
-    } else {
-        std::cout << "Output image saved successfully: " << outputPath << std::endl;
+    if (layers < 2) {
+        // A frame that failed to load has been reported already.
+        const DecodedImage& image = images[0];
+        if (image.pixels) {
+            rendered = processFrame(image.pixels, width, height, image.channels, outputPaths[0].c_str(),
+                                    OutputFormat::Image, pipeline, params);
+        }
+        return 1;
     }
 
-    // Set up vertex data for a fullscreen quad
-    float vertices[] = {
-        -1.0f,  1.0f, 0.0f, 0.0f, 1.0f,
-        -1.0f, -1.0f, 0.0f, 0.0f, 0.0f,
-         1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
-         1.0f,  1.0f, 0.0f, 1.0f, 1.0f
-    };
-    unsigned int indices[] = {
-        0, 1, 2,
-        0, 2, 3
-    };
-
-    unsigned int VBO, VAO, EBO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
-
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
-
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+    updateBlurWeights(pipeline, params);
+    updateParamsBlock(pipeline, params, false);
 
-    // Render
-    glViewport(0, 0, width, height);
-    shader.use();
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-    glClear(GL_COLOR_BUFFER_BIT);
-    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-
-    // Read pixels
-    // std::vector<unsigned char> outputData(width * height * 3);
-    // glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, outputData.data());
-
-    // Save output image
-    stbi_flip_vertically_on_write(true);
-    stbi_write_png(outputPath, width, height, 3, outputData.data(), width * 3);
-
-    // Clean up
-    glDeleteFramebuffers(1, &fbo);
-    glDeleteTextures(1, &luminanceTexture);
-    glDeleteTextures(1, &downscaleTexture);
-    glDeleteTextures(1, &asciiPingTexture);
-    glDeleteTextures(1, &asciiDogTexture);
-    glDeleteTextures(1, &normalsTexture);
-    glDeleteTextures(1, &asciiEdgesTexture);
-    glDeleteTextures(1, &asciiSobelTexture);
-    glDeleteTextures(1, &outputTexture);
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &EBO);
-    stbi_image_free(inputData);
-}
\ No newline at end of file
+    GLResourcePool& pool = pipeline.resources;
+    unsigned int source = pool.acquireTexture(width, height, GL_RGBA8, GLTextureUsage::Upload, layers);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, source);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    for (int layer = 0; layer < layers; ++layer) {
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                        images[layer].pixels);
+    }
+    checkOpenGLError("glTexSubImage3D");
+
+    // The compute path of processFrame with every target an array: PS_Downscale,
+    // the analysis and CS_RenderASCII each dispatch once with z over the
+    // frames, and the ASCII array is read back as a whole.
+    GLFrame frame;
+    frame.pipeline = &pipeline;
+    frame.fbo = 0;
+    frame.width = width;
+    frame.height = height;
+    frame.layers = layers;
+    RenderGraph& graph = frame.graph;
+    for (int& target : frame.targets) target = -1;
+    const int cellsX = (width + 7) / 8;
+    const int cellsY = (height + 7) / 8;
+    const bool full = pipeline.precision == GLPrecision::Full;
+    frame.targets[TARGET_SOURCE] = graph.importTexture("Source", source, width, height, GL_RGBA8, layers);
+    frame.targets[TARGET_DOWNSCALE] = graph.createTexture("Downscale", cellsX, cellsY, full ? GL_RGBA32F : GL_RGBA16F,
+                                                          GLTextureUsage::Storage, layers);
+    frame.targets[TARGET_SOBEL] = graph.createTexture("Sobel", width, height, GL_RG32F, GLTextureUsage::Storage,
+                                                      layers);
+    frame.targets[TARGET_ASCII] = graph.createTexture("ASCII", width, height, GL_RGBA8, GLTextureUsage::Storage,
+                                                      layers);
+
+    int downscale = graph.addPass("CS_Downscale", [&frame] {
+        const RenderGraph& graph = frame.graph;
+        int target = frame.targets[TARGET_DOWNSCALE];
+        frame.pipeline->batchDownscale->use();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, graph.texture(frame.targets[TARGET_SOURCE]));
+        glBindImageTexture(0, graph.texture(target), 0, GL_TRUE, 0, GL_WRITE_ONLY, graph.format(target));
+        glDispatchCompute((frame.width + 63) / 64, (frame.height + 63) / 64, frame.layers);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    });
+    graph.read(downscale, frame.targets[TARGET_SOURCE], 64);
+    graph.write(downscale, frame.targets[TARGET_DOWNSCALE]);
+
+    int analysis = graph.addPass("CS_Analysis", [&frame] {
+        const RenderGraph& graph = frame.graph;
+        int sobel = frame.targets[TARGET_SOBEL];
+        frame.pipeline->batchAnalysis->use();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, graph.texture(frame.targets[TARGET_SOURCE]));
+        glBindImageTexture(0, graph.texture(sobel), 0, GL_TRUE, 0, GL_WRITE_ONLY, graph.format(sobel));
+        glDispatchCompute((frame.width + GL_ANALYSIS_TILE - 1) / GL_ANALYSIS_TILE,
+                          (frame.height + GL_ANALYSIS_TILE - 1) / GL_ANALYSIS_TILE, frame.layers);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    });
+    int span = GL_ANALYSIS_TILE + 2 * ((pipeline.dogWeights.tapCount() - 1) / 2 + 1);
+    graph.read(analysis, frame.targets[TARGET_SOURCE],
+               static_cast<double>(span * span) / (GL_ANALYSIS_TILE * GL_ANALYSIS_TILE));
+    graph.write(analysis, frame.targets[TARGET_SOBEL]);
+
+    int ascii = graph.addPass("CS_RenderASCII", [&frame] {
+        const RenderGraph& graph = frame.graph;
+        Shader& shader = *frame.pipeline->batchCompute;
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, graph.texture(frame.targets[TARGET_SOBEL]));
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, graph.texture(frame.targets[TARGET_DOWNSCALE]));
+        shader.use();
+        shader.setBool("_CellsOnly", false);
+        shader.setIVec2("_ImageSize", frame.width, frame.height);
+        int output = frame.targets[TARGET_ASCII];
+        glBindImageTexture(0, graph.texture(output), 0, GL_TRUE, 0, GL_WRITE_ONLY, graph.format(output));
+        glDispatchCompute((frame.width + 7) / 8, (frame.height + 7) / 8, frame.layers);
+        glMemoryBarrier(GL_PIXEL_BUFFER_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+    });
+    if (params.edges) graph.read(ascii, frame.targets[TARGET_SOBEL]);
+    graph.read(ascii, frame.targets[TARGET_DOWNSCALE]);
+    graph.write(ascii, frame.targets[TARGET_ASCII]);
+
+    // Every frame of the batch in one copy; each is written once it has arrived.
+    std::vector<std::string> paths(outputPaths, outputPaths + layers);
+    int readback = graph.addPass("Readback", [&frame, paths] {
+        int frameHeight = frame.height;
+        ImageWriter* writer = frame.pipeline->writer;
+        frame.pipeline->readback.queueLayers(frame.graph.texture(frame.targets[TARGET_ASCII]), frame.width,
+                                             frame.height, frame.layers,
+                                             [paths, frameHeight, writer](const unsigned char* rgba, int w, int) {
+            size_t frameBytes = static_cast<size_t>(w) * frameHeight * 4;
+            for (size_t layer = 0; layer < paths.size(); ++layer) {
+                writer->write(paths[layer], rgba + layer * frameBytes, w, frameHeight, 4);
+            }
+        });
+        checkOpenGLError("glGetTexImage");
+    }, true);
+    graph.read(readback, frame.targets[TARGET_ASCII]);
+
+    graph.compile();
+    if (width != pipeline.plannedWidth || height != pipeline.plannedHeight || layers != pipeline.plannedLayers) {
+        std::cout << "Render graph for " << layers << " frames of " << width << "x" << height << ":" << std::endl;
+        graph.printPlan();
+        pipeline.plannedWidth = width;
+        pipeline.plannedHeight = height;
+        pipeline.plannedLayers = layers;
+    }
+    graph.execute(pool);
+    pool.releaseTexture(source);
+    return layers;
+}
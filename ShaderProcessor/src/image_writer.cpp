@@ -0,0 +1,245 @@
+#include "image_writer.h"
+#include "png_encoder.h"
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+static const struct {
+    ImageFormat format;
+    const char* name;
+    const char* extension;
+} IMAGE_FORMATS[] = {
+    {ImageFormat::PNG, "png", ".png"},
+    {ImageFormat::QOI, "qoi", ".qoi"},
+    {ImageFormat::PPM, "ppm", ".ppm"},
+    {ImageFormat::PAM, "pam", ".pam"},
+    {ImageFormat::RGB, "rgb", ".rgb"},
+    {ImageFormat::RGBA, "rgba", ".rgba"},
+};
+
+ImageFormat imageFormatForPath(const std::string& path) {
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return ImageFormat::PNG;
+    std::string extension = path.substr(dot);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    for (const auto& entry : IMAGE_FORMATS) {
+        if (extension == entry.extension) return entry.format;
+    }
+    return ImageFormat::PNG;
+}
+
+bool parseImageFormat(const char* name, ImageFormat& format) {
+    for (const auto& entry : IMAGE_FORMATS) {
+        if (strcmp(name, entry.name) == 0) {
+            format = entry.format;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* imageFormatExtension(ImageFormat format) {
+    for (const auto& entry : IMAGE_FORMATS) {
+        if (entry.format == format) return entry.extension;
+    }
+    return ".png";
+}
+
+void encodeQOI(const unsigned char* pixels, int width, int height, int channels, std::vector<unsigned char>& qoi) {
+    const size_t count = static_cast<size_t>(width) * height;
+    qoi.clear();
+    qoi.reserve(14 + count * 4 + 8);
+    const unsigned char header[14] = {'q', 'o', 'i', 'f',
+                                      static_cast<unsigned char>(width >> 24), static_cast<unsigned char>(width >> 16),
+                                      static_cast<unsigned char>(width >> 8), static_cast<unsigned char>(width),
+                                      static_cast<unsigned char>(height >> 24), static_cast<unsigned char>(height >> 16),
+                                      static_cast<unsigned char>(height >> 8), static_cast<unsigned char>(height),
+                                      3, 0};
+    qoi.insert(qoi.end(), header, header + 14);
+
+    // Alpha stays 255 throughout, so QOI_OP_RGBA never occurs and a pixel
+    // is its RGB packed into one word.
+    uint32_t seen[64] = {};
+    bool seenValid[64] = {};
+    uint32_t previous = 0;
+    int run = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const unsigned char* p = pixels + i * channels;
+        uint32_t pixel = p[0] | (p[1] << 8) | (p[2] << 16);
+        if (pixel == previous) {
+            if (++run == 62) {
+                qoi.push_back(static_cast<unsigned char>(0xC0 | (run - 1)));
+                run = 0;
+            }
+            continue;
+        }
+        if (run > 0) {
+            qoi.push_back(static_cast<unsigned char>(0xC0 | (run - 1)));
+            run = 0;
+        }
+
+        int hash = (p[0] * 3 + p[1] * 5 + p[2] * 7 + 255 * 11) % 64;
+        if (seenValid[hash] && seen[hash] == pixel) {
+            qoi.push_back(static_cast<unsigned char>(hash));
+        } else {
+            seen[hash] = pixel;
+            seenValid[hash] = true;
+            signed char dr = static_cast<signed char>(p[0] - (previous & 0xFF));
+            signed char dg = static_cast<signed char>(p[1] - ((previous >> 8) & 0xFF));
+            signed char db = static_cast<signed char>(p[2] - (previous >> 16));
+            int drg = dr - dg, dbg = db - dg;
+            if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                qoi.push_back(static_cast<unsigned char>(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+            } else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7) {
+                qoi.push_back(static_cast<unsigned char>(0x80 | (dg + 32)));
+                qoi.push_back(static_cast<unsigned char>((drg + 8) << 4 | (dbg + 8)));
+            } else {
+                const unsigned char rgb[4] = {0xFE, p[0], p[1], p[2]};
+                qoi.insert(qoi.end(), rgb, rgb + 4);
+            }
+        }
+        previous = pixel;
+    }
+    if (run > 0) qoi.push_back(static_cast<unsigned char>(0xC0 | (run - 1)));
+    const unsigned char end[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+    qoi.insert(qoi.end(), end, end + 8);
+}
+
+static unsigned int writerThreads(unsigned int threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    return threads;
+}
+
+ImageWriter::ImageWriter(ImageFormat format, int pngLevel, unsigned int threads)
+    : imageFormat(format), pngLevel(pngLevel), jobs(1), pool(writerThreads(threads)) {
+    for (unsigned int i = 0; i < writerThreads(threads); ++i) encoders.emplace_back(&ImageWriter::encodeLoop, this);
+}
+
+ImageWriter::~ImageWriter() {
+    flush();
+    jobs.close();
+    for (std::thread& encoder : encoders) encoder.join();
+}
+
+// Each encoder waits for the next image no other encoder has taken. Frames
+// for a stream share one pipe, so each also waits until the frame before it
+// has been written.
+void ImageWriter::encodeLoop() {
+    Job job;
+    while (jobs.take(claimed.fetch_add(1), job)) {
+        if (job.stream) {
+            std::unique_lock<std::mutex> lock(completedMutex);
+            progress.wait(lock, [&] { return streamed == job.streamFrame; });
+            lock.unlock();
+            if (!job.stream->writeFrame(job.pixels.data(), job.width, job.height, job.channels)) {
+                report("output stream", false);
+            }
+        } else {
+            report(job.path, writeFile(job.path, job.pixels.data(), job.width, job.height, job.channels));
+        }
+        job.pixels = std::vector<unsigned char>();
+        std::lock_guard<std::mutex> lock(completedMutex);
+        if (job.stream) ++streamed;
+        ++completed;
+        progress.notify_all();
+    }
+}
+
+void ImageWriter::write(const std::string& path, std::vector<unsigned char> pixels, int width, int height,
+                        int channels) {
+    Job job;
+    job.path = path;
+    job.pixels = std::move(pixels);
+    job.width = width;
+    job.height = height;
+    job.channels = channels;
+    job.stream = videoStream;
+    if (videoStream) job.streamFrame = streamFrames++;
+    auto start = std::chrono::steady_clock::now();
+    jobs.put(submitted++, std::move(job));
+    waited += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void ImageWriter::write(const std::string& path, const unsigned char* pixels, int width, int height,
+                        int channels) {
+    size_t bytes = static_cast<size_t>(width) * height * channels;
+    write(path, std::vector<unsigned char>(pixels, pixels + bytes), width, height, channels);
+}
+
+// Encodes if the format needs it, then writes the file. Formats without
+// compression go from pixels to the file directly when the channel count
+// matches, and row by row through a small buffer when it does not.
+bool ImageWriter::writeFile(const std::string& path, const unsigned char* pixels, int width, int height,
+                            int channels) {
+    std::vector<unsigned char> encoded;
+    char header[128];
+    int headerLength = 0;
+    int outputChannels = 3;
+    switch (imageFormat) {
+    case ImageFormat::PNG:
+        encodePNG(pixels, width, height, channels, pngLevel, pool, encoded);
+        break;
+    case ImageFormat::QOI:
+        encodeQOI(pixels, width, height, channels, encoded);
+        break;
+    case ImageFormat::PPM:
+        headerLength = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+        break;
+    case ImageFormat::PAM:
+        headerLength = snprintf(header, sizeof(header),
+                                "P7\nWIDTH %d\nHEIGHT %d\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n", width,
+                                height);
+        outputChannels = 4;
+        break;
+    case ImageFormat::RGB:
+        break;
+    case ImageFormat::RGBA:
+        outputChannels = 4;
+        break;
+    }
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+    bool ok = true;
+    if (imageFormat == ImageFormat::PNG || imageFormat == ImageFormat::QOI) {
+        ok = fwrite(encoded.data(), 1, encoded.size(), file) == encoded.size();
+    } else {
+        ok = fwrite(header, 1, headerLength, file) == static_cast<size_t>(headerLength);
+        size_t rowBytes = static_cast<size_t>(width) * outputChannels;
+        if (channels == outputChannels) {
+            ok = ok && fwrite(pixels, 1, rowBytes * height, file) == rowBytes * height;
+        } else {
+            std::vector<unsigned char> row(rowBytes, 255);
+            for (int y = 0; y < height && ok; ++y) {
+                const unsigned char* source = pixels + static_cast<size_t>(y) * width * channels;
+                for (int x = 0; x < width; ++x) {
+                    std::copy(source + x * channels, source + x * channels + 3, row.data() + x * outputChannels);
+                }
+                ok = fwrite(row.data(), 1, rowBytes, file) == rowBytes;
+            }
+        }
+    }
+    if (fclose(file) != 0) ok = false;
+    return ok;
+}
+
+void ImageWriter::report(const std::string& path, bool ok) {
+    if (ok) {
+        std::cout << "Output image saved successfully: " + path + "\n";
+    } else {
+        std::cerr << "Failed to write output image: " + path + "\n";
+        failed.store(true);
+    }
+}
+
+bool ImageWriter::flush() {
+    std::unique_lock<std::mutex> lock(completedMutex);
+    progress.wait(lock, [this] { return completed == submitted; });
+    return !failed.exchange(false);
+}
@@ -1,163 +1,255 @@
 #include <KHR/khrplatform.h>
 #include <glad/glad.h>
-#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <memory>
 
 #include "shader.h"
-#include "texture.h"
+#include "gl_context.h"
 #include "image_processor.h"
-
+#include "options.h"
+#include "ascii_params.h"
+#include "cpu_pipeline.h"
+#include "fused_pipeline.h"
+#include "fixed_pipeline.h"
+#include "cpu_kernels.h"
+#include "program_cache.h"
+#include "frame_sequence.h"
+#include "video_stream.h"
+#include "image_input.h"
+
+// Size of the --preview window
 const unsigned int SCR_WIDTH = 1280;
 const unsigned int SCR_HEIGHT = 720;
 
-void error_callback(int error, const char* description)
-{
-    fprintf(stderr, "GLFW Error: %s\n", description);
+// Prints the throughput of a sequence, and how much of the time the thread
+// that renders spent waiting for the decode and encode stages.
+static void reportSequence(size_t frames, std::chrono::steady_clock::time_point start, int batch,
+                           double decodeWait = 0.0, double encodeWait = 0.0) {
+    if (frames < 2) return;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Processed " << frames << " frames in " << seconds << " s (" << frames / seconds << " frames/s";
+    if (batch > 1) std::cout << ", batches of " << batch;
+    std::cout << ")";
+    if (decodeWait > 0.0 || encodeWait > 0.0) {
+        std::cout << ", waited " << 100.0 * decodeWait / seconds << "% of it for decoding and "
+                  << 100.0 * encodeWait / seconds << "% for encoding";
+    }
+    std::cout << std::endl;
+}
+
+// Prints how many threads each stage around the renderer has.
+static void reportStages(const ImageReadAhead& readAhead, const ImageWriter& writer) {
+    std::cout << "Pipeline threads: " << readAhead.threadCount() << " decode, 1 render, " << writer.threadCount()
+              << " encode" << std::endl;
 }
 
-GLFWwindow* initializeWindow(int width, int height) {
-    if (!glfwInit()) {
-        std::cerr << "Failed to initialize GLFW" << std::endl;
-        return nullptr;
+// With stream set, frames come from it instead of the sequence.
+int runCpuBackend(const Options& options, const FrameSequence& sequence, VideoStreamReader* stream,
+                  const AsciiParams& params, ImageWriter& writer) {
+    GlyphAtlas edgesAtlas, fillAtlas;
+    if (!loadGlyphAtlas("../assets/edgesASCII.png", edgesAtlas) || !loadGlyphAtlas("../assets/fillASCII.png", fillAtlas)) {
+        std::cerr << "Failed to load ASCII textures" << std::endl;
+        return -1;
     }
-    
-    glfwSetErrorCallback(error_callback);
-
-    // Try to create an OpenGL 4.3 context
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    #ifdef __APPLE__
-        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-    #endif
-
-    GLFWwindow* window = glfwCreateWindow(width, height, "ASCII Shader", NULL, NULL);
-    if (!window) {
-        // If 4.3 fails, try 3.3
-        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-        window = glfwCreateWindow(width, height, "ASCII Shader (Fallback)", NULL, NULL);
-        if (!window) {
-            std::cerr << "Failed to create GLFW window" << std::endl;
-            glfwTerminate();
-            return nullptr;
+
+    if (!options.simd.empty() && !setCpuKernelLevel(options.simd.c_str())) {
+        std::cerr << "Unknown SIMD level: " << options.simd << std::endl;
+        return -1;
+    }
+
+    ThreadPool pool(options.threads);
+    std::cout << "CPU backend using " << pool.size() << " threads, " << cpuKernels().name << " kernels" << std::endl;
+
+    // One set of intermediates for the whole run, so a sequence reuses the
+    // planes and blur taps of the frame before.
+    CpuIntermediates buffers;
+    FixedIntermediates fixedBuffers;
+    auto runFrame = [&](const CpuImage& input, const char* outputPath) {
+        if (options.backend == Backend::Fused) {
+            return processFrameFused(input, outputPath, options.format, params, edgesAtlas, fillAtlas, pool, writer);
+        } else if (options.backend == Backend::Fixed) {
+            return processFrameFixed(input, outputPath, options.format, params, edgesAtlas, fillAtlas, pool,
+                                     fixedBuffers, writer, options.compare);
         }
+        return processFrameCPU(input, outputPath, options.format, params, edgesAtlas, fillAtlas, pool, buffers,
+                               writer);
+    };
+
+    bool saved = true;
+    auto start = std::chrono::steady_clock::now();
+    if (stream) {
+        std::vector<unsigned char> pixels;
+        size_t frames = 0;
+        while (stream->readFrame(pixels)) {
+            CpuImage input;
+            input.pixels = pixels.data();
+            input.width = stream->width();
+            input.height = stream->height();
+            input.channels = 3;
+            saved = runFrame(input, "-") && saved;
+            ++frames;
+        }
+        saved = writer.flush() && saved;
+        reportSequence(frames, start, 1);
+        return saved ? 0 : -1;
     }
 
-    glfwMakeContextCurrent(window);
+    createOutputDirectory("../output/");
+    ImageReadAhead readAhead(sequence.inputs, options.readAhead, options.decodeThreads);
+    reportStages(readAhead, writer);
+    DecodedImage image;
+    for (size_t frame = 0; frame < sequence.inputs.size(); ++frame) {
+        readAhead.next(image);
+        if (!image.pixels) {
+            saved = false;
+            continue;
+        }
+        CpuImage input;
+        input.pixels = image.pixels;
+        input.width = image.width;
+        input.height = image.height;
+        input.channels = image.channels;
+        saved = runFrame(input, sequence.outputs[frame].c_str()) && saved;
+    }
+    saved = writer.flush() && saved;
+    reportSequence(sequence.inputs.size(), start, 1, readAhead.waitSeconds(), writer.waitSeconds());
+    return saved ? 0 : -1;
+}
 
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        std::cerr << "Failed to initialize GLAD" << std::endl;
-        return nullptr;
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) return -1;
+    AsciiParams params;
+
+    FrameSequence sequence;
+    VideoStreamReader streamReader;
+    std::unique_ptr<VideoStreamWriter> streamWriter;
+    if (options.stream) {
+        // stdout carries the frames, so everything printed goes to stderr.
+        std::cout.rdbuf(std::cerr.rdbuf());
+        bool opened = options.streamWidth > 0 ? streamReader.openRaw(stdin, options.streamWidth, options.streamHeight)
+                                              : streamReader.openY4M(stdin);
+        if (!opened) return -1;
+        streamWriter.reset(new VideoStreamWriter(stdout, streamReader));
+        std::cout << "Streaming " << streamReader.width() << "x" << streamReader.height()
+                  << (streamReader.y4m() ? " Y4M" : " rgb24") << " frames from stdin to stdout" << std::endl;
+    } else if (isSequencePattern(options.inputPath)) {
+        if (!expandSequence(options.inputPath, options.outputPath, sequence)) return -1;
+    } else if (isFileList(options.inputPath)) {
+        if (!expandFileList(options.inputPath, options.outputPath, sequence)) return -1;
+    } else {
+        sequence.inputs.push_back(options.inputPath);
+        sequence.outputs.push_back(options.outputPath);
     }
 
-    return window;
-}
+    // Images are encoded and written on their own threads while the next frame renders.
+    ImageWriter writer(options.imageFormat, options.pngLevel, options.writerThreads);
+    writer.setStream(streamWriter.get());
+    VideoStreamReader* stream = options.stream ? &streamReader : nullptr;
+    if (options.backend != Backend::GL) {
+        return runCpuBackend(options, sequence, stream, params, writer);
+    }
 
-int main() {
     std::cout << "Initializing application..." << std::endl;
-    GLFWwindow* window = initializeWindow(SCR_WIDTH, SCR_HEIGHT);
-    // if (!window) return -1;
-    if (!window) {
-        std::cerr << "Failed to create GLFW window" << std::endl;
+    GLContext context;
+    bool created = options.preview ? createWindowContext(context, SCR_WIDTH, SCR_HEIGHT)
+                                   : createHeadlessContext(context, options.device);
+    if (!created) {
+        std::cerr << "Failed to create an OpenGL context" << std::endl;
         return -1;
     }
-    std::cout << "GLFW window created successfully" << std::endl;
+    std::cout << (options.preview ? "GLFW window" : "Headless EGL context") << " created successfully" << std::endl;
 
     int majorVersion, minorVersion;
     glGetIntegerv(GL_MAJOR_VERSION, &majorVersion);
     glGetIntegerv(GL_MINOR_VERSION, &minorVersion);
     std::cout << "OpenGL Version: " << majorVersion << "." << minorVersion << std::endl;
 
-    Shader* asciiShader;
-    Shader* computeShader = nullptr;
-
-    if (majorVersion > 4 || (majorVersion == 4 && minorVersion >= 3)) {
-        // Use compute shader
-        asciiShader = new Shader("../shaders/vertex.glsl", "../shaders/fragment.glsl");
-        computeShader = new Shader("../shaders/ascii_compute.glsl");
-    } else {
-        // Use fallback fragment shader
-        asciiShader = new Shader("../shaders/vertex.glsl", "../shaders/ascii_fallback.glsl");
+    // Use the compute shader for CS_RenderASCII where available, the fragment fallback otherwise
+    bool useCompute = majorVersion > 4 || (majorVersion == 4 && minorVersion >= 3);
+    setProgramCacheDirectory(options.programCache);
+    auto compileStart = std::chrono::steady_clock::now();
+    GLPipeline pipeline;
+    pipeline.writer = &writer;
+    pipeline.subgroupMode = options.subgroups;
+    pipeline.precision = options.precision;
+    pipeline.fragmentAnalysis = options.fragmentPasses;
+    // Batches run the compute path over texture arrays, image output only.
+    pipeline.batchSize = stream ? 1 : std::min<size_t>(options.batch, sequence.inputs.size());
+    if (pipeline.batchSize > 1 && (!useCompute || options.fragmentPasses || options.format != OutputFormat::Image)) {
+        std::cout << "Batches need compute analysis (OpenGL 4.3) and image output; rendering frame by frame" << std::endl;
+        pipeline.batchSize = 1;
     }
-
-    // Load textures
-    unsigned int inputTexture = loadTexture("../assets/frame1358.png");
-    unsigned int edgesASCIITexture = loadTexture("../assets/edgesASCII.png");
-    unsigned int fillASCIITexture = loadTexture("../assets/fillASCII.png");
-
-    if (edgesASCIITexture == 0 || fillASCIITexture == 0) {
+    GLint maxLayers = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+    if (pipeline.batchSize > maxLayers) pipeline.batchSize = maxLayers;
+    createGLPipeline(pipeline, useCompute);
+    const ProgramCacheStats& cacheStats = programCacheStats();
+    std::cout << "Programs ready in "
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - compileStart).count()
+              << " ms (" << cacheStats.loaded << " cached, " << cacheStats.compiled << " compiled)" << std::endl;
+    pipeline.glyphBenchmarkRuns = options.benchGlyph;
+    pipeline.resources.setBudget(static_cast<size_t>(options.gpuBudget) * 1024 * 1024);
+
+    if (!loadGlyphAtlas("../assets/edgesASCII.png", pipeline.edgesAtlas) ||
+        !loadGlyphAtlas("../assets/fillASCII.png", pipeline.fillAtlas)) {
         std::cerr << "Failed to load ASCII textures" << std::endl;
         return -1;
     }
 
-    unsigned int luminanceTexture = createTexture(SCR_WIDTH, SCR_HEIGHT, GL_R16F);
-    unsigned int downscaleTexture = createTexture(SCR_WIDTH / 8, SCR_HEIGHT / 8, GL_RGBA16F);
-    unsigned int asciiPingTexture = createTexture(SCR_WIDTH, SCR_HEIGHT, GL_RGBA16F);
-    unsigned int asciiDogTexture = createTexture(SCR_WIDTH, SCR_HEIGHT, GL_R16F);
-    unsigned int normalsTexture = createTexture(SCR_WIDTH, SCR_HEIGHT, GL_RGBA16F);
-    unsigned int asciiEdgesTexture = createTexture(SCR_WIDTH, SCR_HEIGHT, GL_R16F);
-    unsigned int asciiSobelTexture = createTexture(SCR_WIDTH, SCR_HEIGHT, GL_RG16F);
-
-    // Set uniforms
-    asciiShader->use();
-    asciiShader->setInt("inputTexture", 0);
-    asciiShader->setInt("FillASCII", 1);
-    asciiShader->setInt("EdgesASCII", 2);
-    asciiShader->setFloat("_Zoom", 1.0f);
-    asciiShader->setVec2("_Offset", 0.0f, 0.0f);
-    asciiShader->setInt("_KernelSize", 2);
-    asciiShader->setFloat("_Sigma", 2.0f);
-    asciiShader->setFloat("_SigmaScale", 1.6f);
-    asciiShader->setFloat("_Tau", 1.0f);
-    asciiShader->setFloat("_Threshold", 0.005f);
-    asciiShader->setBool("_UseDepth", true);
-    asciiShader->setFloat("_DepthThreshold", 0.1f);
-    asciiShader->setBool("_UseNormals", true);
-    asciiShader->setFloat("_NormalThreshold", 0.1f);
-    asciiShader->setFloat("_DepthCutoff", 0.0f);
-    asciiShader->setInt("_EdgeThreshold", 8);
-    asciiShader->setBool("_Edges", true);
-    asciiShader->setBool("_Fill", true);
-    asciiShader->setFloat("_Exposure", 1.0f);
-    asciiShader->setFloat("_Attenuation", 1.0f);
-    asciiShader->setBool("_InvertLuminance", false);
-    asciiShader->setVec3("_ASCIIColor", 1.0f, 1.0f, 1.0f);
-    asciiShader->setVec3("_BackgroundColor", 0.0f, 0.0f, 0.0f);
-    asciiShader->setFloat("_BlendWithBase", 0.0f);
-    asciiShader->setFloat("_DepthFalloff", 0.0f);
-    asciiShader->setFloat("_DepthOffset", 0.0f);
-
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, inputTexture);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, fillASCIITexture);
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, edgesASCIITexture);
-
-    // checkOutputDirectory("../output/");
-
-    // Process image
-    if (majorVersion > 4 || (majorVersion == 4 && minorVersion >= 3)) {
-        processImage("../assets/frame1358.png", "../output/output.png", *asciiShader, edgesASCIITexture, fillASCIITexture, computeShader);
-    } else {
-        processImage("../assets/frame1358.png", "../output/output.png", *asciiShader, edgesASCIITexture, fillASCIITexture);
+    // Process the image, the stream, or the sequence frame by frame or in batches
+    bool saved = true;
+    auto start = std::chrono::steady_clock::now();
+    size_t frames = sequence.inputs.size();
+    if (stream) {
+        std::vector<unsigned char> pixels;
+        while (stream->readFrame(pixels)) {
+            saved = processFrame(pixels.data(), stream->width(), stream->height(), 3, "-", options.format, pipeline,
+                                 params) && saved;
+            ++frames;
+        }
+    }
+    // Files are decoded ahead on their own thread, straight to RGBA for batches.
+    ImageReadAhead readAhead(sequence.inputs, options.readAhead, options.decodeThreads,
+                             pipeline.batchSize > 1 ? 4 : 0);
+    if (!stream) reportStages(readAhead, writer);
+    std::vector<DecodedImage> decoded;
+    if (!sequence.inputs.empty()) createOutputDirectory("../output/");
+    for (size_t frame = 0; frame < sequence.inputs.size();) {
+        DecodedImage image;
+        while (decoded.size() < static_cast<size_t>(pipeline.batchSize) && readAhead.next(image)) {
+            decoded.push_back(std::move(image));
+        }
+        // processBatch ends a batch before a frame that failed to load, so such
+        // a frame always comes first and is consumed alone.
+        int consumed = 1;
+        if (!decoded[0].pixels) {
+            saved = false;
+        } else if (pipeline.batchSize > 1) {
+            bool rendered;
+            consumed = processBatch(decoded.data(), &sequence.outputs[frame], static_cast<int>(decoded.size()),
+                                    pipeline, params, rendered);
+            saved = rendered && saved;
+        } else {
+            saved = processFrame(decoded[0].pixels, decoded[0].width, decoded[0].height, decoded[0].channels,
+                                 sequence.outputs[frame].c_str(), options.format, pipeline, params) && saved;
+        }
+        decoded.erase(decoded.begin(), decoded.begin() + consumed);
+        frame += consumed;
+    }
+    saved = flushGLReadbacks(pipeline) && saved;
+    reportSequence(frames, start, pipeline.batchSize, readAhead.waitSeconds(), writer.waitSeconds());
+
+    // The preview loads the result back through stb_image, which reads PNG and PPM.
+    bool viewable = options.imageFormat == ImageFormat::PNG || options.imageFormat == ImageFormat::PPM;
+    if (options.preview && options.format == OutputFormat::Image && viewable && !stream) {
+        runPreview(context, sequence.outputs.back().c_str());
     }
 
     // Clean up
-    delete asciiShader;
-    if (computeShader) delete computeShader;
-    glDeleteTextures(1, &inputTexture);
-    glDeleteTextures(1, &fillASCIITexture);
-    glDeleteTextures(1, &edgesASCIITexture);
-    glDeleteTextures(1, &luminanceTexture);
-    glDeleteTextures(1, &downscaleTexture);
-    glDeleteTextures(1, &asciiPingTexture);
-    glDeleteTextures(1, &asciiDogTexture);
-    glDeleteTextures(1, &normalsTexture);
-    glDeleteTextures(1, &asciiEdgesTexture);
-    glDeleteTextures(1, &asciiSobelTexture);
-
-    glfwTerminate();
-    return 0;
-}
\ No newline at end of file
+    destroyGLPipeline(pipeline);
+    destroyGLContext(context);
+    return saved ? 0 : -1;
+}
@@ -0,0 +1,173 @@
+#include "options.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+static void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options] [input] [output]\n"
+              << "  input and output may be numbered sequences such as frame%04d.png; input may also be\n"
+              << "  a directory or a quoted glob such as 'frames/*.png'\n"
+              << "  --backend NAME     gl (default), cpu, fused (cache-blocked CPU tiles)\n"
+              << "                     or fixed (8/16-bit fixed-point CPU)\n"
+              << "  --device N         EGL device index for the headless GL context\n"
+              << "  --gl-precision P   half (default) or full float render targets; full matches cpu exactly\n"
+              << "  --fragment-passes  run the GL analysis as one fragment pass per stage, not one compute dispatch\n"
+              << "  --subgroups        use the subgroup ballot vote in CS_RenderASCII wherever supported\n"
+              << "  --no-subgroups     use the shared-memory vote in CS_RenderASCII even with subgroup ballots\n"
+              << "  --bench-glyph N    time N extra CS_RenderASCII dispatches and print the mean\n"
+              << "  --batch N          render N same-sized frames of a sequence per GL dispatch\n"
+              << "  --gpu-budget MB    evict idle pooled GL textures above this much memory\n"
+              << "  --shader-cache DIR keep linked GL programs in DIR (default ../cache/)\n"
+              << "  --no-shader-cache  compile every GL program from source\n"
+              << "  --preview          render in a window and show the result (needs GLFW)\n"
+              << "  --threads N        CPU backend thread count (default: all cores)\n"
+              << "  --simd LEVEL       cap CPU kernels at scalar, sse4.1, avx2 or avx512\n"
+              << "  --format NAME      png, qoi, ppm, pam, rgb or rgba image (default: by output extension, else png),\n"
+              << "                     or text or ansi (one character per 8x8 cell)\n"
+              << "  --png-level N      PNG compression: 0 stored, 1 RLE only, 2-9 more LZ77 effort (default 3)\n"
+              << "  --writer-threads N image writer threads (default: all cores)\n"
+              << "  --read-ahead N     decode up to N input files ahead on separate threads (default 2, 0 for none)\n"
+              << "  --decode-threads N input decoder threads for sequences, at most --read-ahead (default: all cores)\n"
+              << "  --stream           read Y4M frames from stdin and write them processed to stdout\n"
+              << "  --stream-size WxH  with --stream, raw rgb24 frames of this size instead of Y4M\n"
+              << "  --compare          with --backend fixed, report the error against the float pipeline\n"
+              << "  --help             show this message" << std::endl;
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    int positional = 0;
+    bool formatGiven = false;
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+        if (strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0) {
+            printUsage(argv[0]);
+            return false;
+        } else if (strcmp(arg, "--backend") == 0 && value) {
+            if (strcmp(value, "gl") == 0) {
+                options.backend = Backend::GL;
+            } else if (strcmp(value, "cpu") == 0) {
+                options.backend = Backend::CPU;
+            } else if (strcmp(value, "fused") == 0) {
+                options.backend = Backend::Fused;
+            } else if (strcmp(value, "fixed") == 0) {
+                options.backend = Backend::Fixed;
+            } else {
+                std::cerr << "Unknown backend: " << value << std::endl;
+                printUsage(argv[0]);
+                return false;
+            }
+            ++i;
+        } else if (strcmp(arg, "--device") == 0 && value) {
+            options.device = static_cast<int>(std::strtol(value, nullptr, 10));
+            ++i;
+        } else if (strcmp(arg, "--gl-precision") == 0 && value) {
+            if (strcmp(value, "half") == 0) {
+                options.precision = GLPrecision::Half;
+            } else if (strcmp(value, "full") == 0) {
+                options.precision = GLPrecision::Full;
+            } else {
+                std::cerr << "Unknown precision: " << value << std::endl;
+                printUsage(argv[0]);
+                return false;
+            }
+            ++i;
+        } else if (strcmp(arg, "--fragment-passes") == 0) {
+            options.fragmentPasses = true;
+        } else if (strcmp(arg, "--subgroups") == 0) {
+            options.subgroups = 1;
+        } else if (strcmp(arg, "--no-subgroups") == 0) {
+            options.subgroups = 0;
+        } else if (strcmp(arg, "--batch") == 0 && value) {
+            options.batch = static_cast<int>(std::strtol(value, nullptr, 10));
+            if (options.batch < 1) options.batch = 1;
+            ++i;
+        } else if (strcmp(arg, "--bench-glyph") == 0 && value) {
+            options.benchGlyph = static_cast<int>(std::strtol(value, nullptr, 10));
+            ++i;
+        } else if (strcmp(arg, "--gpu-budget") == 0 && value) {
+            options.gpuBudget = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+            ++i;
+        } else if (strcmp(arg, "--shader-cache") == 0 && value) {
+            options.programCache = value;
+            ++i;
+        } else if (strcmp(arg, "--no-shader-cache") == 0) {
+            options.programCache.clear();
+        } else if (strcmp(arg, "--preview") == 0) {
+            options.preview = true;
+        } else if (strcmp(arg, "--threads") == 0 && value) {
+            options.threads = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+            ++i;
+        } else if (strcmp(arg, "--simd") == 0 && value) {
+            options.simd = value;
+            ++i;
+        } else if (strcmp(arg, "--png-level") == 0 && value) {
+            options.pngLevel = static_cast<int>(std::strtol(value, nullptr, 10));
+            if (options.pngLevel < PNG_LEVEL_STORED || options.pngLevel > PNG_LEVEL_MAX) {
+                std::cerr << "PNG level must be " << PNG_LEVEL_STORED << " to " << PNG_LEVEL_MAX << std::endl;
+                return false;
+            }
+            ++i;
+        } else if (strcmp(arg, "--writer-threads") == 0 && value) {
+            options.writerThreads = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+            ++i;
+        } else if (strcmp(arg, "--read-ahead") == 0 && value) {
+            options.readAhead = static_cast<int>(std::strtol(value, nullptr, 10));
+            if (options.readAhead < 0) options.readAhead = 0;
+            ++i;
+        } else if (strcmp(arg, "--decode-threads") == 0 && value) {
+            options.decodeThreads = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+            ++i;
+        } else if (strcmp(arg, "--stream") == 0) {
+            options.stream = true;
+        } else if (strcmp(arg, "--stream-size") == 0 && value) {
+            char* end = nullptr;
+            options.streamWidth = static_cast<int>(std::strtol(value, &end, 10));
+            options.streamHeight = (*end == 'x') ? static_cast<int>(std::strtol(end + 1, nullptr, 10)) : 0;
+            if (options.streamWidth <= 0 || options.streamHeight <= 0) {
+                std::cerr << "Stream size must be WIDTHxHEIGHT: " << value << std::endl;
+                return false;
+            }
+            options.stream = true;
+            ++i;
+        } else if (strcmp(arg, "--compare") == 0) {
+            options.compare = true;
+        } else if (strcmp(arg, "--format") == 0 && value) {
+            if (parseImageFormat(value, options.imageFormat)) {
+                options.format = OutputFormat::Image;
+                formatGiven = true;
+            } else if (strcmp(value, "text") == 0) {
+                options.format = OutputFormat::Text;
+            } else if (strcmp(value, "ansi") == 0) {
+                options.format = OutputFormat::ANSI;
+            } else {
+                std::cerr << "Unknown output format: " << value << std::endl;
+                printUsage(argv[0]);
+                return false;
+            }
+            ++i;
+        } else if (arg[0] != '-' && positional == 0) {
+            options.inputPath = arg;
+            ++positional;
+        } else if (arg[0] != '-' && positional == 1) {
+            options.outputPath = arg;
+            ++positional;
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            printUsage(argv[0]);
+            return false;
+        }
+    }
+    if (positional < 2 && options.format == OutputFormat::Text) options.outputPath = "../output/output.txt";
+    if (positional < 2 && options.format == OutputFormat::ANSI) options.outputPath = "../output/output.ans";
+    if (positional < 2 && options.format == OutputFormat::Image) {
+        options.outputPath = std::string("../output/output") + imageFormatExtension(options.imageFormat);
+    }
+    if (options.stream && options.format != OutputFormat::Image) {
+        std::cerr << "--stream writes video frames; text formats need files" << std::endl;
+        return false;
+    }
+    if (!formatGiven) options.imageFormat = imageFormatForPath(options.outputPath);
+    return true;
+}
@@ -0,0 +1,615 @@
+#include "png_encoder.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+// Filtered bytes per deflate group; fixed, so the output is the same on any
+// number of threads.
+static const size_t GROUP_BYTES = 128 * 1024;
+static const size_t WINDOW = 32768;
+static const int MIN_MATCH = 3;
+static const int MAX_MATCH = 258;
+static const size_t BLOCK_TOKENS = 32768;  // symbols per dynamic Huffman block
+static const int HASH_BITS = 15;
+
+static const uint16_t LENGTH_BASE[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                         31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                         2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t DISTANCE_BASE[30] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,
+                                           33,  49,  65,  97,  129, 193,  257,  385,  513,  769,
+                                           1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t DISTANCE_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                           6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+static const uint8_t CODE_LENGTH_ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+// Length and distance to their deflate codes, 0-based (length code 257 is 0).
+struct DeflateTables {
+    uint8_t lengthCode[MAX_MATCH + 1];
+    uint8_t distanceCode[512];  // distance - 1 below 256, else 256 + ((distance - 1) >> 7)
+
+    DeflateTables() {
+        for (int code = 0; code < 29; ++code) {
+            int end = code == 28 ? MAX_MATCH + 1 : LENGTH_BASE[code + 1];
+            for (int length = LENGTH_BASE[code]; length < end; ++length) lengthCode[length] = static_cast<uint8_t>(code);
+        }
+        for (int code = 0; code < 30; ++code) {
+            int end = code == 29 ? 32769 : DISTANCE_BASE[code + 1];
+            for (int distance = DISTANCE_BASE[code]; distance < end; ++distance) {
+                int index = distance <= 256 ? distance - 1 : 256 + ((distance - 1) >> 7);
+                distanceCode[index] = static_cast<uint8_t>(code);
+            }
+        }
+    }
+
+    int distance(int d) const { return distanceCode[d <= 256 ? d - 1 : 256 + ((d - 1) >> 7)]; }
+};
+
+static const DeflateTables& deflateTables() {
+    static const DeflateTables tables;
+    return tables;
+}
+
+static const uint32_t* crcTable() {
+    static uint32_t table[256];
+    static bool built = [] {
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+        return true;
+    }();
+    (void)built;
+    return table;
+}
+
+static uint32_t crc32(uint32_t crc, const unsigned char* data, size_t length) {
+    const uint32_t* table = crcTable();
+    crc = ~crc;
+    for (size_t i = 0; i < length; ++i) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static const uint32_t ADLER_BASE = 65521;
+
+static uint32_t adler32(const unsigned char* data, size_t length) {
+    uint32_t a = 1, b = 0;
+    while (length > 0) {
+        // 5552 bytes is the most b can take before it needs reducing.
+        size_t n = std::min<size_t>(length, 5552);
+        length -= n;
+        while (n-- > 0) {
+            a += *data++;
+            b += a;
+        }
+        a %= ADLER_BASE;
+        b %= ADLER_BASE;
+    }
+    return (b << 16) | a;
+}
+
+// Adler-32 of two byte ranges joined, from their own checksums and the
+// length of the second.
+static uint32_t adler32Combine(uint32_t first, uint32_t second, size_t secondLength) {
+    uint32_t remainder = static_cast<uint32_t>(secondLength % ADLER_BASE);
+    uint32_t a = first & 0xFFFF;
+    uint32_t b = static_cast<uint32_t>((static_cast<uint64_t>(remainder) * a) % ADLER_BASE);
+    a += (second & 0xFFFF) + ADLER_BASE - 1;
+    b += (first >> 16) + (second >> 16) + ADLER_BASE - remainder;
+    if (a >= ADLER_BASE) a -= ADLER_BASE;
+    if (a >= ADLER_BASE) a -= ADLER_BASE;
+    if (b >= 2 * ADLER_BASE) b -= 2 * ADLER_BASE;
+    if (b >= ADLER_BASE) b -= ADLER_BASE;
+    return (b << 16) | a;
+}
+
+static void putBigEndian(std::vector<unsigned char>& out, uint32_t value) {
+    out.push_back(static_cast<unsigned char>(value >> 24));
+    out.push_back(static_cast<unsigned char>(value >> 16));
+    out.push_back(static_cast<unsigned char>(value >> 8));
+    out.push_back(static_cast<unsigned char>(value));
+}
+
+// Deflate's bit order: values go in least significant bit first.
+struct BitWriter {
+    std::vector<unsigned char>& out;
+    uint64_t bits = 0;
+    int count = 0;
+
+    explicit BitWriter(std::vector<unsigned char>& out) : out(out) {}
+
+    void put(uint32_t value, int length) {
+        bits |= static_cast<uint64_t>(value) << count;
+        count += length;
+        while (count >= 8) {
+            out.push_back(static_cast<unsigned char>(bits));
+            bits >>= 8;
+            count -= 8;
+        }
+    }
+
+    void alignToByte() {
+        if (count > 0) out.push_back(static_cast<unsigned char>(bits));
+        bits = 0;
+        count = 0;
+    }
+};
+
+// A literal byte (distance 0) or a match of length bytes distance back.
+struct Token {
+    uint16_t value;
+    uint16_t distance;
+};
+
+// Huffman code lengths for the symbols' frequencies, none longer than
+// maxBits. An over-long tree is rebuilt from flattened frequencies until it
+// fits. At least two symbols get a code, as some decoders reject a code of one.
+static void buildCodeLengths(const uint32_t* frequencies, int count, int maxBits, uint8_t* lengths) {
+    std::vector<uint32_t> weights(frequencies, frequencies + count);
+    int used = 0;
+    for (int i = 0; i < count; ++i) used += weights[i] != 0;
+    for (int i = 0; used < 2 && i < count; ++i) {
+        if (weights[i] == 0) {
+            weights[i] = 1;
+            ++used;
+        }
+    }
+
+    std::vector<int> leaves;
+    std::vector<uint64_t> nodeWeight;
+    std::vector<int> parent;
+    std::vector<int> depth;
+    for (;;) {
+        leaves.clear();
+        for (int i = 0; i < count; ++i) {
+            if (weights[i] != 0) leaves.push_back(i);
+        }
+        std::sort(leaves.begin(), leaves.end(), [&](int a, int b) {
+            return weights[a] != weights[b] ? weights[a] < weights[b] : a < b;
+        });
+
+        // Two queues: sorted leaves, and internal nodes, which are created in
+        // order of weight.
+        int n = static_cast<int>(leaves.size());
+        nodeWeight.assign(2 * n - 1, 0);
+        parent.assign(2 * n - 1, -1);
+        for (int i = 0; i < n; ++i) nodeWeight[i] = weights[leaves[i]];
+        int nextLeaf = 0, nextInternal = n;
+        for (int node = n; node < 2 * n - 1; ++node) {
+            int children[2];
+            for (int& child : children) {
+                if (nextLeaf < n && (nextInternal >= node || nodeWeight[nextLeaf] <= nodeWeight[nextInternal])) {
+                    child = nextLeaf++;
+                } else {
+                    child = nextInternal++;
+                }
+            }
+            nodeWeight[node] = nodeWeight[children[0]] + nodeWeight[children[1]];
+            parent[children[0]] = parent[children[1]] = node;
+        }
+
+        // Parents come after their children, so one backward pass sets every depth.
+        depth.assign(2 * n - 1, 0);
+        int longest = 0;
+        for (int node = 2 * n - 3; node >= 0; --node) {
+            depth[node] = depth[parent[node]] + 1;
+            if (node < n) longest = std::max(longest, depth[node]);
+        }
+        if (longest <= maxBits) {
+            std::fill(lengths, lengths + count, 0);
+            for (int i = 0; i < n; ++i) lengths[leaves[i]] = static_cast<uint8_t>(depth[i]);
+            return;
+        }
+        for (uint32_t& weight : weights) {
+            if (weight != 0) weight = weight / 2 + 1;
+        }
+    }
+}
+
+// Canonical codes for the lengths, bit-reversed for writing LSB first.
+static void buildCodes(const uint8_t* lengths, int count, uint16_t* codes) {
+    int lengthCount[16] = {};
+    for (int i = 0; i < count; ++i) ++lengthCount[lengths[i]];
+    lengthCount[0] = 0;
+    int next[16] = {};
+    int code = 0;
+    for (int bits = 1; bits < 16; ++bits) {
+        code = (code + lengthCount[bits - 1]) << 1;
+        next[bits] = code;
+    }
+    for (int i = 0; i < count; ++i) {
+        int length = lengths[i];
+        if (length == 0) continue;
+        int value = next[length]++;
+        int reversed = 0;
+        for (int bit = 0; bit < length; ++bit) reversed |= ((value >> bit) & 1) << (length - 1 - bit);
+        codes[i] = static_cast<uint16_t>(reversed);
+    }
+}
+
+static void writeStoredBlocks(BitWriter& out, const unsigned char* data, size_t length, bool final) {
+    do {
+        size_t chunk = std::min<size_t>(length, 65535);
+        length -= chunk;
+        out.put(final && length == 0 ? 1 : 0, 1);
+        out.put(0, 2);
+        out.alignToByte();
+        out.put(static_cast<uint32_t>(chunk), 16);
+        out.put(static_cast<uint32_t>(~chunk & 0xFFFF), 16);
+        out.out.insert(out.out.end(), data, data + chunk);
+        data += chunk;
+    } while (length > 0);
+}
+
+// Writes tokens as one dynamic Huffman block, or as stored blocks of data,
+// the bytes they encode, when that is smaller.
+static void writeBlock(BitWriter& out, const std::vector<Token>& tokens, const unsigned char* data, size_t length,
+                       bool final) {
+    const DeflateTables& tables = deflateTables();
+    uint32_t literalFrequencies[286] = {};
+    uint32_t distanceFrequencies[30] = {};
+    for (const Token& token : tokens) {
+        if (token.distance == 0) {
+            ++literalFrequencies[token.value];
+        } else {
+            ++literalFrequencies[257 + tables.lengthCode[token.value]];
+            ++distanceFrequencies[tables.distance(token.distance)];
+        }
+    }
+    literalFrequencies[256] = 1;
+
+    uint8_t literalLengths[286], distanceLengths[30];
+    buildCodeLengths(literalFrequencies, 286, 15, literalLengths);
+    buildCodeLengths(distanceFrequencies, 30, 15, distanceLengths);
+    int literalCount = 286, distanceCount = 30;
+    while (literalCount > 257 && literalLengths[literalCount - 1] == 0) --literalCount;
+    while (distanceCount > 1 && distanceLengths[distanceCount - 1] == 0) --distanceCount;
+
+    // Both length sequences, run-length coded with symbols 16 to 18.
+    uint8_t allLengths[286 + 30];
+    std::copy(literalLengths, literalLengths + literalCount, allLengths);
+    std::copy(distanceLengths, distanceLengths + distanceCount, allLengths + literalCount);
+    int total = literalCount + distanceCount;
+    std::vector<std::pair<uint8_t, uint8_t>> lengthSymbols;  // symbol, repeat bits
+    uint32_t lengthFrequencies[19] = {};
+    for (int i = 0; i < total;) {
+        int value = allLengths[i];
+        int run = 1;
+        while (i + run < total && allLengths[i + run] == value) ++run;
+        if (value == 0 && run >= 3) {
+            run = std::min(run, 138);
+            lengthSymbols.push_back(run >= 11 ? std::make_pair(uint8_t(18), uint8_t(run - 11))
+                                              : std::make_pair(uint8_t(17), uint8_t(run - 3)));
+        } else if (value != 0 && run >= 4) {
+            lengthSymbols.push_back({static_cast<uint8_t>(value), 0});
+            run = std::min(run - 1, 6);
+            lengthSymbols.push_back({16, static_cast<uint8_t>(run - 3)});
+            ++run;
+        } else {
+            run = 1;
+            lengthSymbols.push_back({static_cast<uint8_t>(value), 0});
+        }
+        i += run;
+    }
+    for (const auto& symbol : lengthSymbols) ++lengthFrequencies[symbol.first];
+
+    uint8_t codeLengthLengths[19];
+    buildCodeLengths(lengthFrequencies, 19, 7, codeLengthLengths);
+    int codeLengthCount = 19;
+    while (codeLengthCount > 4 && codeLengthLengths[CODE_LENGTH_ORDER[codeLengthCount - 1]] == 0) --codeLengthCount;
+
+    // Compare sizes in bits before writing anything.
+    static const int REPEAT_BITS[3] = {2, 3, 7};
+    uint64_t dynamicBits = 3 + 5 + 5 + 4 + 3 * codeLengthCount;
+    for (const auto& symbol : lengthSymbols) {
+        dynamicBits += codeLengthLengths[symbol.first] + (symbol.first >= 16 ? REPEAT_BITS[symbol.first - 16] : 0);
+    }
+    for (int symbol = 0; symbol < 286; ++symbol) dynamicBits += uint64_t(literalFrequencies[symbol]) * literalLengths[symbol];
+    for (int code = 0; code < 29; ++code) dynamicBits += uint64_t(literalFrequencies[257 + code]) * LENGTH_EXTRA[code];
+    for (int code = 0; code < 30; ++code) {
+        dynamicBits += uint64_t(distanceFrequencies[code]) * (distanceLengths[code] + DISTANCE_EXTRA[code]);
+    }
+    uint64_t storedBits = (length + 5 * ((length + 65534) / 65535 + (length == 0))) * 8 + 8;
+    if (storedBits <= dynamicBits) {
+        writeStoredBlocks(out, data, length, final);
+        return;
+    }
+
+    uint16_t literalCodes[286], distanceCodes[30], codeLengthCodes[19];
+    buildCodes(literalLengths, 286, literalCodes);
+    buildCodes(distanceLengths, 30, distanceCodes);
+    buildCodes(codeLengthLengths, 19, codeLengthCodes);
+
+    out.put(final ? 1 : 0, 1);
+    out.put(2, 2);
+    out.put(literalCount - 257, 5);
+    out.put(distanceCount - 1, 5);
+    out.put(codeLengthCount - 4, 4);
+    for (int i = 0; i < codeLengthCount; ++i) out.put(codeLengthLengths[CODE_LENGTH_ORDER[i]], 3);
+    for (const auto& symbol : lengthSymbols) {
+        out.put(codeLengthCodes[symbol.first], codeLengthLengths[symbol.first]);
+        if (symbol.first >= 16) out.put(symbol.second, REPEAT_BITS[symbol.first - 16]);
+    }
+
+    for (const Token& token : tokens) {
+        if (token.distance == 0) {
+            out.put(literalCodes[token.value], literalLengths[token.value]);
+            continue;
+        }
+        int lengthCode = tables.lengthCode[token.value];
+        out.put(literalCodes[257 + lengthCode], literalLengths[257 + lengthCode]);
+        out.put(token.value - LENGTH_BASE[lengthCode], LENGTH_EXTRA[lengthCode]);
+        int distanceCode = tables.distance(token.distance);
+        out.put(distanceCodes[distanceCode], distanceLengths[distanceCode]);
+        out.put(token.distance - DISTANCE_BASE[distanceCode], DISTANCE_EXTRA[distanceCode]);
+    }
+    out.put(literalCodes[256], literalLengths[256]);
+}
+
+static uint32_t hash3(const unsigned char* p) {
+    uint32_t value = p[0] | (p[1] << 8) | (p[2] << 16);
+    return (value * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Deflates data[begin, end) as a continuation of everything before begin:
+// matches reach back up to WINDOW bytes, into the previous group. Unless the
+// group is the last, it ends with an empty stored block, which leaves the
+// stream byte-aligned and open for the next group.
+static void deflateGroup(const unsigned char* data, size_t begin, size_t end, int level, bool last,
+                         std::vector<unsigned char>& output) {
+    BitWriter out(output);
+    if (level <= PNG_LEVEL_STORED) {
+        writeStoredBlocks(out, data + begin, end - begin, last);
+    } else {
+        std::vector<Token> tokens;
+        tokens.reserve(BLOCK_TOKENS + 1);
+        size_t blockBegin = begin;
+        auto flushBlock = [&](size_t position, bool final) {
+            writeBlock(out, tokens, data + blockBegin, position - blockBegin, final);
+            tokens.clear();
+            blockBegin = position;
+        };
+
+        if (level == PNG_LEVEL_RLE) {
+            for (size_t position = begin; position < end;) {
+                size_t run = 0;
+                if (position > 0) {
+                    size_t limit = std::min<size_t>(MAX_MATCH, end - position);
+                    while (run < limit && data[position + run] == data[position - 1]) ++run;
+                }
+                if (run >= static_cast<size_t>(MIN_MATCH)) {
+                    tokens.push_back({static_cast<uint16_t>(run), 1});
+                    position += run;
+                } else {
+                    tokens.push_back({data[position], 0});
+                    ++position;
+                }
+                if (tokens.size() >= BLOCK_TOKENS && position < end) flushBlock(position, false);
+            }
+        } else {
+            const int maxChain = 4 << (level - 2);
+            const int niceLength = std::min(MAX_MATCH, 8 << (level - 2));
+            const bool lazy = level >= 4;
+            const size_t windowStart = begin > WINDOW ? begin - WINDOW : 0;
+            std::vector<int32_t> head(size_t(1) << HASH_BITS, -1);
+            std::vector<int32_t> previous(end - windowStart);
+            auto insert = [&](size_t position) {
+                if (position + MIN_MATCH > end) return;
+                uint32_t h = hash3(data + position);
+                previous[position - windowStart] = head[h];
+                head[h] = static_cast<int32_t>(position - windowStart);
+            };
+            auto longestMatch = [&](size_t position, int& distance) {
+                int best = 0;
+                if (position + MIN_MATCH > end) return best;
+                int limit = static_cast<int>(std::min<size_t>(MAX_MATCH, end - position));
+                int32_t candidate = head[hash3(data + position)];
+                for (int chain = maxChain; candidate >= 0 && chain > 0; --chain) {
+                    size_t match = windowStart + candidate;
+                    if (position - match > WINDOW) break;
+                    if (data[match + best] == data[position + best]) {
+                        int length = 0;
+                        while (length < limit && data[match + length] == data[position + length]) ++length;
+                        if (length > best) {
+                            best = length;
+                            distance = static_cast<int>(position - match);
+                            if (best >= niceLength || best == limit) break;
+                        }
+                    }
+                    candidate = previous[candidate];
+                }
+                // A three-byte match far back costs more bits than its literals.
+                if (best == MIN_MATCH && distance > 4096) return 0;
+                return best >= MIN_MATCH ? best : 0;
+            };
+
+            // The previous group's tail is the dictionary.
+            for (size_t position = windowStart; position < begin; ++position) insert(position);
+            size_t position = begin;
+            while (position < end) {
+                int distance = 0;
+                int length = longestMatch(position, distance);
+                insert(position);
+                if (length > 0 && lazy && length < niceLength && position + 1 < end) {
+                    int nextDistance = 0;
+                    int nextLength = longestMatch(position + 1, nextDistance);
+                    if (nextLength > length) {
+                        tokens.push_back({data[position], 0});
+                        ++position;
+                        length = nextLength;
+                        distance = nextDistance;
+                        insert(position);
+                    }
+                }
+                if (length > 0) {
+                    tokens.push_back({static_cast<uint16_t>(length), static_cast<uint16_t>(distance)});
+                    for (size_t i = position + 1; i < position + length; ++i) insert(i);
+                    position += length;
+                } else {
+                    tokens.push_back({data[position], 0});
+                    ++position;
+                }
+                if (tokens.size() >= BLOCK_TOKENS && position < end) flushBlock(position, false);
+            }
+        }
+        flushBlock(end, last);
+    }
+
+    if (last) {
+        out.alignToByte();
+    } else {
+        writeStoredBlocks(out, nullptr, 0, false);
+    }
+}
+
+// Written with the distances expanded, so it compiles without branches.
+static inline int paeth(int a, int b, int c) {
+    int pa = std::abs(b - c), pb = std::abs(a - c), pc = std::abs(a + b - 2 * c);
+    int ab = pb < pa ? b : a;
+    return pc < std::min(pa, pb) ? c : ab;
+}
+
+// Filters one RGB row into out (filter type byte, then the row), choosing
+// the filter whose bytes have the smallest sum as signed values. The scores
+// of all five come from one pass that stores nothing, which the compiler can
+// vectorize; only the winner is written. The stored level keeps every row
+// unfiltered.
+static void filterRow(const unsigned char* row, const unsigned char* above, int rowBytes, int level,
+                      unsigned char* out, std::vector<unsigned char>& zeros) {
+    out[0] = 0;
+    if (level <= PNG_LEVEL_STORED) {
+        std::copy(row, row + rowBytes, out + 1);
+        return;
+    }
+    // The first row predicts from a row of zeros, and the first pixel from
+    // zero neighbours on its left.
+    if (!above) {
+        zeros.assign(rowBytes, 0);
+        above = zeros.data();
+    }
+    const int bpp = 3;
+    auto predict = [](int filter, int a, int b, int c) {
+        switch (filter) {
+        case 1: return a;
+        case 2: return b;
+        case 3: return (a + b) >> 1;
+        case 4: return paeth(a, b, c);
+        default: return 0;
+        }
+    };
+    auto score = [](int value) { return std::abs(static_cast<int>(static_cast<signed char>(value))); };
+
+    long scores[5] = {};
+    for (int i = 0; i < bpp && i < rowBytes; ++i) {
+        for (int filter = 0; filter < 5; ++filter) scores[filter] += score(row[i] - predict(filter, 0, above[i], 0));
+    }
+    int none = 0, sub = 0, up = 0, average = 0, paethScore = 0;  // at most 127 per byte
+    for (int i = bpp; i < rowBytes; ++i) {
+        int x = row[i], a = row[i - bpp], b = above[i], c = above[i - bpp];
+        none += score(x);
+        sub += score(x - a);
+        up += score(x - b);
+        average += score(x - ((a + b) >> 1));
+        paethScore += score(x - paeth(a, b, c));
+    }
+    scores[0] += none;
+    scores[1] += sub;
+    scores[2] += up;
+    scores[3] += average;
+    scores[4] += paethScore;
+
+    int best = 0;
+    for (int filter = 1; filter < 5; ++filter) {
+        if (scores[filter] < scores[best]) best = filter;
+    }
+    out[0] = static_cast<unsigned char>(best);
+    for (int i = 0; i < rowBytes; ++i) {
+        int a = i >= bpp ? row[i - bpp] : 0;
+        int c = i >= bpp ? above[i - bpp] : 0;
+        out[i + 1] = static_cast<unsigned char>(row[i] - predict(best, a, above[i], c));
+    }
+}
+
+static void appendChunk(std::vector<unsigned char>& png, const char* type, const unsigned char* data, size_t length) {
+    putBigEndian(png, static_cast<uint32_t>(length));
+    size_t start = png.size();
+    png.insert(png.end(), type, type + 4);
+    png.insert(png.end(), data, data + length);
+    putBigEndian(png, crc32(0, png.data() + start, length + 4));
+}
+
+void encodePNG(const unsigned char* pixels, int width, int height, int channels, int level, ThreadPool& pool,
+               std::vector<unsigned char>& png) {
+    level = std::max(PNG_LEVEL_STORED, std::min(level, PNG_LEVEL_MAX));
+    const int rowBytes = width * 3;
+    const size_t stride = static_cast<size_t>(rowBytes) + 1;
+    std::vector<unsigned char> filtered(stride * height);
+    pool.parallelFor(0, height, 16, [&](int rowBegin, int rowEnd) {
+        std::vector<unsigned char> row, above, zeros;
+        auto rgbRow = [&](int y, std::vector<unsigned char>& rgb) {
+            const unsigned char* source = pixels + static_cast<size_t>(y) * width * channels;
+            if (channels == 3) return source;
+            rgb.resize(rowBytes);
+            for (int x = 0; x < width; ++x) {
+                rgb[x * 3] = source[x * channels];
+                rgb[x * 3 + 1] = source[x * channels + 1];
+                rgb[x * 3 + 2] = source[x * channels + 2];
+            }
+            return static_cast<const unsigned char*>(rgb.data());
+        };
+        const unsigned char* previous = rowBegin > 0 ? rgbRow(rowBegin - 1, above) : nullptr;
+        for (int y = rowBegin; y < rowEnd; ++y) {
+            const unsigned char* current = rgbRow(y, row);
+            filterRow(current, previous, rowBytes, level, filtered.data() + y * stride, zeros);
+            if (channels != 3) std::swap(row, above);
+            previous = channels == 3 ? current : above.data();
+        }
+    });
+
+    // Each group becomes one IDAT chunk, zlib header in front of the first.
+    // The Adler-32 of the whole stream goes in an IDAT of its own at the end.
+    int rowsPerGroup = static_cast<int>(std::max<size_t>(1, GROUP_BYTES / stride));
+    int groupCount = (height + rowsPerGroup - 1) / rowsPerGroup;
+    std::vector<std::vector<unsigned char>> chunks(groupCount);
+    std::vector<uint32_t> checksums(groupCount);
+    const unsigned char zlibFlags = level <= PNG_LEVEL_RLE ? 0x01 : level <= 5 ? 0x5E : level == 6 ? 0x9C : 0xDA;
+    pool.parallelFor(0, groupCount, 1, [&](int groupBegin, int groupEnd) {
+        for (int group = groupBegin; group < groupEnd; ++group) {
+            size_t begin = static_cast<size_t>(group) * rowsPerGroup * stride;
+            size_t end = std::min(filtered.size(), begin + static_cast<size_t>(rowsPerGroup) * stride);
+            std::vector<unsigned char> stream;
+            stream.reserve((end - begin) / 4 + 64);
+            if (group == 0) {
+                stream.push_back(0x78);
+                stream.push_back(zlibFlags);
+            }
+            deflateGroup(filtered.data(), begin, end, level, group == groupCount - 1, stream);
+            checksums[group] = adler32(filtered.data() + begin, end - begin);
+
+            std::vector<unsigned char>& chunk = chunks[group];
+            chunk.reserve(stream.size() + 12);
+            appendChunk(chunk, "IDAT", stream.data(), stream.size());
+        }
+    });
+
+    uint32_t checksum = 1;
+    for (int group = 0; group < groupCount; ++group) {
+        size_t begin = static_cast<size_t>(group) * rowsPerGroup * stride;
+        size_t length = std::min(filtered.size(), begin + static_cast<size_t>(rowsPerGroup) * stride) - begin;
+        checksum = adler32Combine(checksum, checksums[group], length);
+    }
+
+    static const unsigned char SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    png.assign(SIGNATURE, SIGNATURE + 8);
+    std::vector<unsigned char> header;
+    putBigEndian(header, static_cast<uint32_t>(width));
+    putBigEndian(header, static_cast<uint32_t>(height));
+    header.insert(header.end(), {8, 2, 0, 0, 0});  // 8-bit RGB, deflate, adaptive filters, no interlace
+    appendChunk(png, "IHDR", header.data(), header.size());
+    for (const std::vector<unsigned char>& chunk : chunks) png.insert(png.end(), chunk.begin(), chunk.end());
+    std::vector<unsigned char> trailer;
+    putBigEndian(trailer, checksum);
+    appendChunk(png, "IDAT", trailer.data(), trailer.size());
+    appendChunk(png, "IEND", nullptr, 0);
+}
@@ -0,0 +1,151 @@
+#include "program_cache.h"
+#include <KHR/khrplatform.h>
+#include <glad/glad.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+static std::string cacheDirectory = "../cache/";
+static ProgramCacheStats stats;
+
+// Header of a cache file, followed by length bytes of binary.
+struct ProgramCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;  // GL binary format the driver reported
+    uint32_t length;
+};
+
+static const char CACHE_MAGIC[4] = {'A', 'S', 'P', 'B'};
+static const uint32_t CACHE_VERSION = 1;
+
+void setProgramCacheDirectory(const std::string& directory) {
+    cacheDirectory = directory;
+    if (!cacheDirectory.empty() && cacheDirectory.back() != '/') cacheDirectory += '/';
+}
+
+const ProgramCacheStats& programCacheStats() {
+    return stats;
+}
+
+// Program binaries are only usable where the driver hands out at least one format.
+static bool cacheAvailable() {
+    if (cacheDirectory.empty() || !GLAD_GL_VERSION_4_1) return false;
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+static std::string cachePath(uint64_t key) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+    return cacheDirectory + name;
+}
+
+// 64-bit FNV-1a, continued from hash.
+static uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static uint64_t hashString(uint64_t hash, const char* text) {
+    if (!text) text = "";
+    // The terminator separates fields, so "ab" + "c" and "a" + "bc" differ.
+    return hashBytes(hash, text, std::strlen(text) + 1);
+}
+
+uint64_t programCacheKey(const std::string* sources, int count) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    hash = hashString(hash, reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+    hash = hashString(hash, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+    hash = hashString(hash, reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+    for (int i = 0; i < count; ++i) hash = hashString(hash, sources[i].c_str());
+    return hash;
+}
+
+bool loadProgramBinary(unsigned int program, uint64_t key) {
+    if (!cacheAvailable()) return false;
+    std::ifstream file(cachePath(key), std::ios::binary);
+    if (!file) return false;
+
+    ProgramCacheHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION ||
+        header.key != key) {
+        return false;
+    }
+    std::vector<char> binary(header.length);
+    if (!file.read(binary.data(), binary.size())) return false;
+
+    // A driver update keeps the version string but may still refuse the
+    // binary; that leaves the program unlinked, and the caller compiles.
+    glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE) return false;
+    ++stats.loaded;
+    return true;
+}
+
+void prepareProgramBinary(unsigned int program) {
+    ++stats.compiled;
+    if (cacheAvailable()) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+static bool createCacheDirectory() {
+    std::string path = cacheDirectory.substr(0, cacheDirectory.size() - 1);
+    if (mkdir(path.c_str(), 0777) == 0 || errno == EEXIST) return true;
+    std::cerr << "Error creating program cache directory " << path << ": " << strerror(errno) << std::endl;
+    return false;
+}
+
+void storeProgramBinary(unsigned int program, uint64_t key) {
+    if (!cacheAvailable()) return;
+    GLint linked = GL_FALSE, length = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (linked != GL_TRUE || length <= 0) return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+    if (length <= 0 || !createCacheDirectory()) return;
+
+    ProgramCacheHeader header;
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.key = key;
+    header.format = format;
+    header.length = static_cast<uint32_t>(length);
+
+    // Written aside and renamed into place, so a job starting alongside
+    // never reads a half-written entry.
+    std::string path = cachePath(key);
+    std::string partial = path + "." + std::to_string(getpid()) + ".tmp";
+    {
+        std::ofstream file(partial, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(binary.data(), length);
+        if (!file) {
+            std::cerr << "Failed to write program cache entry " << partial << std::endl;
+            std::remove(partial.c_str());
+            return;
+        }
+    }
+    if (std::rename(partial.c_str(), path.c_str()) != 0) {
+        std::remove(partial.c_str());
+        return;
+    }
+    ++stats.stored;
+}
@@ -0,0 +1,193 @@
+#include "render_graph.h"
+#include <algorithm>
+#include <iostream>
+
+int RenderGraph::createTexture(const char* name, int width, int height, GLenum internalFormat,
+                               GLTextureUsage usage, int layers) {
+    textures.push_back({name, width, height, layers, internalFormat, usage, 0});
+    return static_cast<int>(textures.size()) - 1;
+}
+
+int RenderGraph::importTexture(const char* name, unsigned int texture, int width, int height,
+                               GLenum internalFormat, int layers) {
+    textures.push_back({name, width, height, layers, internalFormat, GLTextureUsage::Upload, texture});
+    return static_cast<int>(textures.size()) - 1;
+}
+
+int RenderGraph::addPass(const char* name, std::function<void()> execute, bool sideEffect) {
+    passes.push_back({name, std::move(execute), sideEffect, false, {}, {}});
+    return static_cast<int>(passes.size()) - 1;
+}
+
+void RenderGraph::read(int pass, int texture, double fetches) {
+    const Texture& source = textures[texture];
+    // Passes run in the order they were added, so the writer must come first.
+    if (source.imported == 0 && (source.writer < 0 || source.writer >= pass)) {
+        std::cerr << "Render graph: " << passes[pass].name << " reads " << source.name
+                  << " before any pass writes it" << std::endl;
+        return;
+    }
+    passes[pass].reads.push_back({texture, fetches});
+}
+
+void RenderGraph::write(int pass, int texture) {
+    Texture& target = textures[texture];
+    if (target.imported != 0 || target.writer >= 0) {
+        std::cerr << "Render graph: " << passes[pass].name << " writes " << target.name
+                  << ", which already has its contents" << std::endl;
+        return;
+    }
+    target.writer = pass;
+    passes[pass].writes.push_back(texture);
+}
+
+void RenderGraph::compile() {
+    // Walk back from the side effects: every writer precedes its readers, so
+    // one reverse sweep marks everything they depend on.
+    for (Pass& pass : passes) pass.live = pass.sideEffect;
+    for (int i = static_cast<int>(passes.size()) - 1; i >= 0; --i) {
+        if (!passes[i].live) continue;
+        for (const Access& access : passes[i].reads) {
+            int writer = textures[access.texture].writer;
+            if (writer >= 0) passes[writer].live = true;
+        }
+    }
+
+    for (Texture& texture : textures) {
+        texture.lastRead = -1;
+        texture.physical = -1;
+    }
+    for (int i = 0; i < static_cast<int>(passes.size()); ++i) {
+        if (!passes[i].live) continue;
+        for (const Access& access : passes[i].reads) textures[access.texture].lastRead = i;
+    }
+
+    // Transients in order of their writers; each takes the first matching
+    // physical texture whose current lifetime ended before its own starts.
+    physical.clear();
+    for (int i = 0; i < static_cast<int>(passes.size()); ++i) {
+        if (!passes[i].live) continue;
+        for (int handle : passes[i].writes) {
+            Texture& texture = textures[handle];
+            int lastUse = texture.lastRead > i ? texture.lastRead : i;
+            for (size_t p = 0; p < physical.size(); ++p) {
+                Physical& slot = physical[p];
+                if (slot.lastUse < i && slot.width == texture.width && slot.height == texture.height &&
+                    slot.layers == texture.layers && slot.internalFormat == texture.internalFormat && slot.usage == texture.usage) {
+                    slot.lastUse = lastUse;
+                    texture.physical = static_cast<int>(p);
+                    break;
+                }
+            }
+            if (texture.physical < 0) {
+                physical.push_back({texture.width, texture.height, texture.layers, texture.internalFormat,
+                                    texture.usage, lastUse});
+                texture.physical = static_cast<int>(physical.size()) - 1;
+            }
+        }
+    }
+}
+
+void RenderGraph::execute(GLResourcePool& pool) {
+    for (Physical& slot : physical) {
+        slot.texture = pool.acquireTexture(slot.width, slot.height, slot.internalFormat, slot.usage, slot.layers);
+    }
+    for (Pass& pass : passes) {
+        if (pass.live) pass.execute();
+    }
+    for (Physical& slot : physical) {
+        pool.releaseTexture(slot.texture);
+        slot.texture = 0;
+    }
+}
+
+unsigned int RenderGraph::texture(int handle) const {
+    const Texture& texture = textures[handle];
+    if (texture.imported != 0) return texture.imported;
+    return texture.physical >= 0 ? physical[texture.physical].texture : 0;
+}
+
+size_t RenderGraph::textureBytes(const Texture& texture, GLenum internalFormat) const {
+    return static_cast<size_t>(texture.width) * texture.height * texture.layers * glFormatBytes(internalFormat);
+}
+
+static const char* formatName(GLenum internalFormat) {
+    switch (internalFormat) {
+    case GL_R8: return "R8";
+    case GL_R16F: return "R16F";
+    case GL_RG16F: return "RG16F";
+    case GL_RGBA8: return "RGBA8";
+    case GL_RGBA16F: return "RGBA16F";
+    case GL_R32F: return "R32F";
+    case GL_RG32F: return "RG32F";
+    case GL_RGBA32F: return "RGBA32F";
+    default: return "?";
+    }
+}
+
+void RenderGraph::printPlan() const {
+    const double megabyte = 1024.0 * 1024.0;
+    int live = 0;
+    std::string culled;
+    for (const Pass& pass : passes) {
+        if (pass.live) {
+            ++live;
+        } else {
+            culled += " " + pass.name;
+        }
+    }
+    std::cout << "  " << live << " passes";
+    if (!culled.empty()) std::cout << ", culled" << culled;
+    std::cout << std::endl;
+
+    size_t memory = 0, memoryUnaliased = 0, memoryRGBA32F = 0;
+    std::cout << "  textures:";
+    for (const Texture& texture : textures) {
+        if (texture.imported != 0 || texture.physical < 0) continue;
+        memoryUnaliased += textureBytes(texture, texture.internalFormat);
+        memoryRGBA32F += textureBytes(texture, GL_RGBA32F);
+        std::cout << " " << texture.name << " " << formatName(texture.internalFormat) << " #" << texture.physical;
+    }
+    for (const Physical& slot : physical) {
+        memory += static_cast<size_t>(slot.width) * slot.height * slot.layers * glFormatBytes(slot.internalFormat);
+    }
+    std::cout << "\n  memory " << memory / megabyte << " MB in " << physical.size() << " textures ("
+              << memoryUnaliased / megabyte << " MB unaliased, " << memoryRGBA32F / megabyte << " MB as RGBA32F)"
+              << std::endl;
+
+    // A layered graph renders a whole batch, so its figures are per batch.
+    int layers = 1;
+    for (const Texture& texture : textures) layers = std::max(layers, texture.layers);
+
+    size_t traffic = 0, trafficRGBA32F = 0;
+    for (const Pass& pass : passes) {
+        if (!pass.live) continue;
+        size_t bytes = 0, bytesRGBA32F = 0;
+        for (int handle : pass.writes) {
+            bytes += textureBytes(textures[handle], textures[handle].internalFormat);
+            bytesRGBA32F += textureBytes(textures[handle], GL_RGBA32F);
+        }
+        // Fetches are per texel of the pass's first output, or of the input
+        // itself for a readback.
+        const Texture* output = pass.writes.empty() ? nullptr : &textures[pass.writes[0]];
+        for (const Access& access : pass.reads) {
+            const Texture& input = textures[access.texture];
+            const Texture& counted = output ? *output : input;
+            double fetched = static_cast<double>(counted.width) * counted.height * counted.layers * access.fetches;
+            bytes += static_cast<size_t>(fetched * glFormatBytes(input.internalFormat));
+            GLenum formatRGBA32F = input.imported != 0 ? input.internalFormat : GL_RGBA32F;
+            bytesRGBA32F += static_cast<size_t>(fetched * glFormatBytes(formatRGBA32F));
+        }
+        traffic += bytes;
+        trafficRGBA32F += bytesRGBA32F;
+        std::cout << "  " << pass.name << ": " << bytes / megabyte << " MB" << std::endl;
+    }
+    if (layers > 1) {
+        std::cout << "  traffic per batch of " << layers << " " << traffic / megabyte << " MB, per frame "
+                  << traffic / layers / megabyte << " MB (" << trafficRGBA32F / layers / megabyte
+                  << " MB as RGBA32F)" << std::endl;
+    } else {
+        std::cout << "  traffic per frame " << traffic / megabyte << " MB (" << trafficRGBA32F / megabyte
+                  << " MB as RGBA32F)" << std::endl;
+    }
+}
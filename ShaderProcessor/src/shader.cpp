@@ -1,37 +1,57 @@
 #include "shader.h"
+#include "program_cache.h"
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
+std::string readShaderSource(const std::string& path, const std::string& defines) {
+    std::ifstream file;
+    file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    file.open(path);
+    std::stringstream stream;
+    stream << file.rdbuf();
+    file.close();
+
+    std::string directory = path.substr(0, path.find_last_of('/') + 1);
+    std::string source, line;
+    std::istringstream lines(stream.str());
+    while (std::getline(lines, line)) {
+        size_t open = line.find("#include \"");
+        size_t close = open == std::string::npos ? open : line.find('"', open + 10);
+        if (open == line.find_first_not_of(" \t") && close != std::string::npos) {
+            source += readShaderSource(directory + line.substr(open + 10, close - open - 10));
+        } else {
+            source += line + "\n";
+            if (!defines.empty() && source.size() == line.size() + 1 && line.compare(0, 8, "#version") == 0) {
+                source += defines;
+                if (defines.back() != '\n') source += '\n';
+            }
+        }
+    }
+    return source;
+}
+
 Shader::Shader(const char* vertexPath, const char* fragmentPath) {
     // 1. retrieve the vertex/fragment source code from filePath
     std::string vertexCode;
     std::string fragmentCode;
-    std::ifstream vShaderFile;
-    std::ifstream fShaderFile;
-    // ensure ifstream objects can throw exceptions:
-    vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-    fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
     try 
     {
-        // open files
-        vShaderFile.open(vertexPath);
-        fShaderFile.open(fragmentPath);
-        std::stringstream vShaderStream, fShaderStream;
-        // read file's buffer contents into streams
-        vShaderStream << vShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();
-        // close file handlers
-        vShaderFile.close();
-        fShaderFile.close();
-        // convert stream into string
-        vertexCode   = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
+        vertexCode   = readShaderSource(vertexPath);
+        fragmentCode = readShaderSource(fragmentPath);
     }
     catch (std::ifstream::failure& e)
     {
         std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
     }
+    ID = glCreateProgram();
+    std::string sources[] = {vertexCode, fragmentCode};
+    uint64_t cacheKey = programCacheKey(sources, 2);
+    if (loadProgramBinary(ID, cacheKey)) {
+        reflectUniforms();
+        return;
+    }
+
     const char* vShaderCode = vertexCode.c_str();
     const char * fShaderCode = fragmentCode.c_str();
     // 2. compile shaders
@@ -45,13 +65,15 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
     glShaderSource(fragment, 1, &fShaderCode, NULL);
     glCompileShader(fragment);
     // shader Program
-    ID = glCreateProgram();
     glAttachShader(ID, vertex);
     glAttachShader(ID, fragment);
+    prepareProgramBinary(ID);
     glLinkProgram(ID);
     // delete the shaders as they're linked into our program now and no longer necessery
     glDeleteShader(vertex);
     glDeleteShader(fragment);
+    storeProgramBinary(ID, cacheKey);
+    reflectUniforms();
 }
 
 void Shader::use() { 
@@ -59,36 +81,100 @@ void Shader::use() {
 }
 
 void Shader::setBool(const std::string &name, bool value) const {         
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+    glUniform1i(uniformLocation(name), (int)value); 
 }
 void Shader::setInt(const std::string &name, int value) const { 
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+    glUniform1i(uniformLocation(name), value); 
 }
 void Shader::setFloat(const std::string &name, float value) const { 
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+    glUniform1f(uniformLocation(name), value); 
 }
 void Shader::setVec2(const std::string &name, float x, float y) const {
-    glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+    glUniform2f(uniformLocation(name), x, y);
+}
+void Shader::setIVec2(const std::string &name, int x, int y) const {
+    glUniform2i(uniformLocation(name), x, y);
 }
 void Shader::setVec3(const std::string &name, float x, float y, float z) const { 
-    glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+    glUniform3f(uniformLocation(name), x, y, z); 
+}
+void Shader::setVec2Array(const std::string &name, const float* values, int count) const {
+    glUniform2fv(uniformLocation(name), count, values);
+}
+
+// Every active uniform's location, looked up once so the setters never go
+// back to the driver with a string. Arrays are stored under their bare name
+// as well as "name[0]".
+void Shader::reflectUniforms() {
+    uniformLocations.clear();
+    GLint count = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        char name[256];
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(ID, static_cast<GLuint>(i), sizeof(name), &length, &size, &type, name);
+        int location = glGetUniformLocation(ID, name);
+        if (location < 0) continue;  // uniform block members have no location
+        std::string key(name, length);
+        uniformLocations[key] = location;
+        if (key.size() > 3 && key.compare(key.size() - 3, 3, "[0]") == 0) {
+            uniformLocations[key.substr(0, key.size() - 3)] = location;
+        }
+    }
+}
+
+int Shader::uniformLocation(const std::string &name) const {
+    auto it = uniformLocations.find(name);
+    return it == uniformLocations.end() ? -1 : it->second;
+}
+
+void Shader::bindUniformBlock(const std::string &name, unsigned int binding) const {
+    GLuint index = glGetUniformBlockIndex(ID, name.c_str());
+    if (index != GL_INVALID_INDEX) glUniformBlockBinding(ID, index, binding);
+}
+
+int Shader::uniformBlockSize(const std::string &name) const {
+    GLuint index = glGetUniformBlockIndex(ID, name.c_str());
+    if (index == GL_INVALID_INDEX) return -1;
+    GLint size = 0;
+    glGetActiveUniformBlockiv(ID, index, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+    return size;
 }
 
 Shader::Shader(const char* computePath) {
     // Read compute shader
     std::string computeCode;
-    std::ifstream cShaderFile;
-    cShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
     try {
-        cShaderFile.open(computePath);
-        std::stringstream cShaderStream;
-        cShaderStream << cShaderFile.rdbuf();
-        cShaderFile.close();
-        computeCode = cShaderStream.str();
+        computeCode = readShaderSource(computePath);
     }
     catch (std::ifstream::failure& e) {
         std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
     }
+    buildCompute(computeCode);
+}
+
+Shader* Shader::compute(const char* computePath, const std::string& defines) {
+    std::string computeCode;
+    try {
+        computeCode = readShaderSource(computePath, defines);
+    }
+    catch (std::ifstream::failure& e) {
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
+    }
+    Shader* shader = new Shader();
+    shader->buildCompute(computeCode);
+    return shader;
+}
+
+void Shader::buildCompute(const std::string& computeCode) {
+    ID = glCreateProgram();
+    uint64_t cacheKey = programCacheKey(&computeCode, 1);
+    if (loadProgramBinary(ID, cacheKey)) {
+        reflectUniforms();
+        return;
+    }
     const char* cShaderCode = computeCode.c_str();
 
     // Compile compute shader
@@ -99,13 +185,15 @@ Shader::Shader(const char* computePath) {
     checkCompileErrors(compute, "COMPUTE");
 
     // Shader Program
-    ID = glCreateProgram();
     glAttachShader(ID, compute);
+    prepareProgramBinary(ID);
     glLinkProgram(ID);
     checkCompileErrors(ID, "PROGRAM");
 
     // Delete the shaders as they're linked into our program now and no longer necessary
     glDeleteShader(compute);
+    storeProgramBinary(ID, cacheKey);
+    reflectUniforms();
 }
 
 void Shader::checkCompileErrors(unsigned int shader, std::string type)
@@ -0,0 +1,113 @@
+#include "task_graph.h"
+#include <algorithm>
+
+int TaskGraph::add(std::function<void()> body) {
+    tasks.emplace_back();
+    tasks.back().body = std::move(body);
+    return static_cast<int>(tasks.size()) - 1;
+}
+
+void TaskGraph::depend(int task, int prerequisite) {
+    tasks[prerequisite].dependents.push_back(task);
+    ++tasks[task].prerequisites;
+}
+
+void TaskGraph::run(ThreadPool& pool) {
+    if (tasks.empty()) return;
+
+    const size_t workerCount = pool.size();
+    queues.clear();
+    for (size_t i = 0; i < workerCount; ++i) {
+        queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue));
+    }
+    pending.reset(new std::atomic<int>[tasks.size()]);
+    std::vector<int> roots;
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        pending[i].store(tasks[i].prerequisites);
+        if (tasks[i].prerequisites == 0) roots.push_back(static_cast<int>(i));
+    }
+
+    // Each thread starts on its own contiguous block of roots, first root at
+    // the back where the thread pops, last at the front where thieves steal.
+    for (size_t i = 0; i < roots.size(); ++i) {
+        size_t worker = i * workerCount / roots.size();
+        queues[worker]->ready.push_front(roots[i]);
+    }
+    readyCount.store(static_cast<int>(roots.size()));
+    remaining.store(static_cast<int>(tasks.size()));
+    sleeping.store(0);
+
+    pool.parallelFor(0, static_cast<int>(workerCount), 1, [this](int w0, int w1) {
+        for (int worker = w0; worker < w1; ++worker) {
+            workerLoop(static_cast<size_t>(worker));
+        }
+    });
+}
+
+void TaskGraph::workerLoop(size_t worker) {
+    while (remaining.load() > 0) {
+        int task;
+        if (popTask(worker, task)) {
+            tasks[task].body();
+            finishTask(worker, task);
+            continue;
+        }
+        // Nothing ready anywhere: wait for a running task to release one.
+        // sleeping is raised before readyCount is checked, and pushReady
+        // raises readyCount before checking sleeping, so a wakeup is never lost.
+        std::unique_lock<std::mutex> lock(idleMutex);
+        sleeping.fetch_add(1);
+        idle.wait(lock, [this] { return readyCount.load() > 0 || remaining.load() == 0; });
+        sleeping.fetch_sub(1);
+    }
+}
+
+bool TaskGraph::popTask(size_t worker, int& task) {
+    {
+        WorkerQueue& own = *queues[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.ready.empty()) {
+            task = own.ready.back();
+            own.ready.pop_back();
+            readyCount.fetch_sub(1);
+            return true;
+        }
+    }
+    for (size_t i = 1; i < queues.size(); ++i) {
+        WorkerQueue& victim = *queues[(worker + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.ready.empty()) {
+            task = victim.ready.front();
+            victim.ready.pop_front();
+            readyCount.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TaskGraph::pushReady(size_t worker, int task) {
+    {
+        WorkerQueue& own = *queues[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        own.ready.push_back(task);
+    }
+    readyCount.fetch_add(1);
+    wakeIdle();
+}
+
+void TaskGraph::finishTask(size_t worker, int task) {
+    // Pushed in reverse so the first dependent is the next one popped.
+    const std::vector<int>& dependents = tasks[task].dependents;
+    for (auto it = dependents.rbegin(); it != dependents.rend(); ++it) {
+        if (pending[*it].fetch_sub(1) == 1) pushReady(worker, *it);
+    }
+    if (remaining.fetch_sub(1) == 1) wakeIdle();
+}
+
+void TaskGraph::wakeIdle() {
+    if (sleeping.load() > 0) {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        idle.notify_all();
+    }
+}
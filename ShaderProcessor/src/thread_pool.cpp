@@ -0,0 +1,102 @@
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+
+ThreadPool::ThreadPool(unsigned int threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned int i = 1; i < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    taskAvailable.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::workerLoop() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            taskAvailable.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) return;
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+bool ThreadPool::runPendingTask() {
+    std::function<void()> task;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tasks.empty()) return false;
+        task = std::move(tasks.front());
+        tasks.pop_front();
+    }
+    task();
+    return true;
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    if (workers.empty()) {
+        task();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    taskAvailable.notify_one();
+}
+
+void ThreadPool::parallelFor(int begin, int end, int grain, const std::function<void(int, int)>& body) {
+    if (end <= begin) return;
+    grain = std::max(1, grain);
+
+    // A few bands per thread keeps the load balanced when rows differ in cost.
+    int units = (end - begin + grain - 1) / grain;
+    int bandCount = std::min(units, static_cast<int>(size()) * 4);
+    if (bandCount <= 1) {
+        body(begin, end);
+        return;
+    }
+    int unitsPerBand = (units + bandCount - 1) / bandCount;
+    bandCount = (units + unitsPerBand - 1) / unitsPerBand;
+
+    std::atomic<int> remaining(bandCount);
+    std::mutex doneMutex;
+    std::condition_variable done;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int band = 0; band < bandCount; ++band) {
+            int bandBegin = begin + band * unitsPerBand * grain;
+            int bandEnd = std::min(end, bandBegin + unitsPerBand * grain);
+            tasks.emplace_back([&, bandBegin, bandEnd] {
+                body(bandBegin, bandEnd);
+                if (remaining.fetch_sub(1) == 1) {
+                    std::lock_guard<std::mutex> doneLock(doneMutex);
+                    done.notify_one();
+                }
+            });
+        }
+    }
+    taskAvailable.notify_all();
+
+    // The caller works through the queue too instead of sitting idle.
+    while (remaining.load() > 0 && runPendingTask()) {
+    }
+    std::unique_lock<std::mutex> lock(doneMutex);
+    done.wait(lock, [&] { return remaining.load() == 0; });
+}
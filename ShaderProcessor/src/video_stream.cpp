@@ -0,0 +1,209 @@
+#include "video_stream.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+static const char Y4M_MAGIC[] = "YUV4MPEG2";
+static const char Y4M_FRAME[] = "FRAME";
+
+// Reads up to and including the next newline, at most limit bytes of it.
+static bool readLine(FILE* file, std::string& line, size_t limit) {
+    line.clear();
+    int c;
+    while ((c = fgetc(file)) != EOF && c != '\n') {
+        if (line.size() == limit) return false;
+        line.push_back(static_cast<char>(c));
+    }
+    return c == '\n';
+}
+
+// Width and height of the chroma planes; 0 x 0 for mono.
+static void chromaSize(ChromaFormat chroma, int width, int height, int& chromaWidth, int& chromaHeight) {
+    chromaWidth = chroma == ChromaFormat::Y444 ? width : (width + 1) / 2;
+    chromaHeight = chroma == ChromaFormat::Y420 ? (height + 1) / 2 : height;
+    if (chroma == ChromaFormat::Mono) chromaWidth = chromaHeight = 0;
+}
+
+static size_t frameBytes(ChromaFormat chroma, int width, int height) {
+    int chromaWidth, chromaHeight;
+    chromaSize(chroma, width, height, chromaWidth, chromaHeight);
+    return static_cast<size_t>(width) * height + 2 * static_cast<size_t>(chromaWidth) * chromaHeight;
+}
+
+static unsigned char clampByte(int value) {
+    return static_cast<unsigned char>(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+bool VideoStreamReader::openY4M(FILE* file) {
+    input = file;
+    isY4M = true;
+    std::string header;
+    if (!readLine(file, header, 4096) || header.compare(0, sizeof(Y4M_MAGIC) - 1, Y4M_MAGIC) != 0) {
+        std::cerr << "Input stream is not YUV4MPEG2" << std::endl;
+        return false;
+    }
+
+    chromaFormat = ChromaFormat::Y420;
+    parameters.clear();
+    size_t position = sizeof(Y4M_MAGIC) - 1;
+    while (position < header.size()) {
+        size_t end = header.find(' ', position + 1);
+        if (end == std::string::npos) end = header.size();
+        std::string token = header.substr(position + 1, end - position - 1);
+        position = end;
+        if (token.empty()) continue;
+        if (token[0] == 'W') {
+            frameWidth = atoi(token.c_str() + 1);
+            continue;
+        }
+        if (token[0] == 'H') {
+            frameHeight = atoi(token.c_str() + 1);
+            continue;
+        }
+        if (token[0] == 'C') {
+            std::string chroma = token.substr(1);
+            if (chroma == "420jpeg" || chroma == "420paldv" || chroma == "420mpeg2" || chroma == "420") {
+                chromaFormat = ChromaFormat::Y420;
+            } else if (chroma == "422") {
+                chromaFormat = ChromaFormat::Y422;
+            } else if (chroma == "444") {
+                chromaFormat = ChromaFormat::Y444;
+            } else if (chroma == "mono") {
+                chromaFormat = ChromaFormat::Mono;
+            } else {
+                std::cerr << "Unsupported Y4M chroma format " << chroma
+                          << "; convert to 8-bit yuv420p, yuv422p, yuv444p or gray first" << std::endl;
+                return false;
+            }
+        }
+        if (token[0] == 'I' && token != "Ip") {
+            std::cerr << "Unsupported Y4M interlacing " << token.substr(1)
+                      << "; deinterlace to progressive frames first" << std::endl;
+            return false;
+        }
+        parameters += " " + token;
+    }
+    if (frameWidth <= 0 || frameHeight <= 0) {
+        std::cerr << "Y4M header has no frame size" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool VideoStreamReader::openRaw(FILE* file, int width, int height) {
+    input = file;
+    isY4M = false;
+    frameWidth = width;
+    frameHeight = height;
+    return width > 0 && height > 0;
+}
+
+bool VideoStreamReader::readFrame(std::vector<unsigned char>& rgb) {
+    const size_t pixels = static_cast<size_t>(frameWidth) * frameHeight;
+    rgb.resize(pixels * 3);
+    if (!isY4M) {
+        size_t read = fread(rgb.data(), 1, rgb.size(), input);
+        if (read != 0 && read != rgb.size()) std::cerr << "Input stream ends inside a frame" << std::endl;
+        return read == rgb.size();
+    }
+
+    std::string frameHeader;
+    if (!readLine(input, frameHeader, 1024)) {
+        if (!frameHeader.empty()) std::cerr << "Input stream ends inside a frame header" << std::endl;
+        return false;
+    }
+    if (frameHeader.compare(0, sizeof(Y4M_FRAME) - 1, Y4M_FRAME) != 0) {
+        std::cerr << "Y4M frame does not start with FRAME" << std::endl;
+        return false;
+    }
+    planes.resize(frameBytes(chromaFormat, frameWidth, frameHeight));
+    if (fread(planes.data(), 1, planes.size(), input) != planes.size()) {
+        std::cerr << "Input stream ends inside a frame" << std::endl;
+        return false;
+    }
+
+    // BT.601 limited range in 8.8 fixed point. Subsampled chroma is repeated
+    // over the pixels it covers.
+    int chromaWidth, chromaHeight;
+    chromaSize(chromaFormat, frameWidth, frameHeight, chromaWidth, chromaHeight);
+    const unsigned char* luma = planes.data();
+    const unsigned char* cb = luma + pixels;
+    const unsigned char* cr = cb + static_cast<size_t>(chromaWidth) * chromaHeight;
+    const int shiftX = chromaFormat == ChromaFormat::Y444 ? 0 : 1;
+    const int shiftY = chromaFormat == ChromaFormat::Y420 ? 1 : 0;
+    for (int y = 0; y < frameHeight; ++y) {
+        const unsigned char* lumaRow = luma + static_cast<size_t>(y) * frameWidth;
+        const size_t chromaRow = static_cast<size_t>(y >> shiftY) * chromaWidth;
+        unsigned char* out = rgb.data() + static_cast<size_t>(y) * frameWidth * 3;
+        for (int x = 0; x < frameWidth; ++x) {
+            int c = 298 * (lumaRow[x] - 16) + 128;
+            int u = 0, v = 0;
+            if (chromaFormat != ChromaFormat::Mono) {
+                u = cb[chromaRow + (x >> shiftX)] - 128;
+                v = cr[chromaRow + (x >> shiftX)] - 128;
+            }
+            out[x * 3 + 0] = clampByte((c + 409 * v) >> 8);
+            out[x * 3 + 1] = clampByte((c - 100 * u - 208 * v) >> 8);
+            out[x * 3 + 2] = clampByte((c + 516 * u) >> 8);
+        }
+    }
+    return true;
+}
+
+VideoStreamWriter::VideoStreamWriter(FILE* file, const VideoStreamReader& reader)
+    : output(file), isY4M(reader.y4m()), chromaFormat(reader.chroma()), parameters(reader.streamParameters()) {}
+
+bool VideoStreamWriter::writeFrame(const unsigned char* pixels, int width, int height, int channels) {
+    if (!isY4M) {
+        const size_t bytes = static_cast<size_t>(width) * height * 3;
+        if (channels == 3) return fwrite(pixels, 1, bytes, output) == bytes;
+        planes.resize(static_cast<size_t>(width) * 3);
+        for (int y = 0; y < height; ++y) {
+            const unsigned char* row = pixels + static_cast<size_t>(y) * width * channels;
+            for (int x = 0; x < width; ++x) std::copy(row + x * channels, row + x * channels + 3, &planes[x * 3]);
+            if (fwrite(planes.data(), 1, planes.size(), output) != planes.size()) return false;
+        }
+        return true;
+    }
+
+    if (!headerWritten) {
+        fprintf(output, "%s W%d H%d%s\n", Y4M_MAGIC, width, height, parameters.c_str());
+        headerWritten = true;
+    }
+
+    // The inverse of the reader's conversion; subsampled chroma is the mean
+    // of the RGB it covers.
+    const size_t count = static_cast<size_t>(width) * height;
+    int chromaWidth, chromaHeight;
+    chromaSize(chromaFormat, width, height, chromaWidth, chromaHeight);
+    planes.resize(frameBytes(chromaFormat, width, height));
+    unsigned char* luma = planes.data();
+    unsigned char* cb = luma + count;
+    unsigned char* cr = cb + static_cast<size_t>(chromaWidth) * chromaHeight;
+    for (size_t i = 0; i < count; ++i) {
+        const unsigned char* p = pixels + i * channels;
+        luma[i] = static_cast<unsigned char>(((66 * p[0] + 129 * p[1] + 25 * p[2] + 128) >> 8) + 16);
+    }
+    const int blockWidth = chromaFormat == ChromaFormat::Y444 ? 1 : 2;
+    const int blockHeight = chromaFormat == ChromaFormat::Y420 ? 2 : 1;
+    for (int cy = 0; cy < chromaHeight; ++cy) {
+        for (int cx = 0; cx < chromaWidth; ++cx) {
+            int r = 0, g = 0, b = 0, n = 0;
+            for (int y = cy * blockHeight; y < std::min(height, (cy + 1) * blockHeight); ++y) {
+                for (int x = cx * blockWidth; x < std::min(width, (cx + 1) * blockWidth); ++x) {
+                    const unsigned char* p = pixels + (static_cast<size_t>(y) * width + x) * channels;
+                    r += p[0];
+                    g += p[1];
+                    b += p[2];
+                    ++n;
+                }
+            }
+            size_t i = static_cast<size_t>(cy) * chromaWidth + cx;
+            cb[i] = clampByte(((-38 * r - 74 * g + 112 * b) / n + 128 * 257) >> 8);
+            cr[i] = clampByte(((112 * r - 94 * g - 18 * b) / n + 128 * 257) >> 8);
+        }
+    }
+    return fwrite(Y4M_FRAME, 1, sizeof(Y4M_FRAME) - 1, output) == sizeof(Y4M_FRAME) - 1 && fputc('\n', output) != EOF &&
+           fwrite(planes.data(), 1, planes.size(), output) == planes.size();
+}